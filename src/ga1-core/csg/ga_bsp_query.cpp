@@ -0,0 +1,294 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+** Evan Wallace - CSG.js - https://github.com/evanw/csg.js
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_bsp_query.h"
+#include "ga_csg_jobs.h"
+#include "ga_node.h"
+
+#include "framework/ga_compiler_defines.h"
+
+#include <algorithm>
+#include <vector>
+
+#if defined(GA_AVX2)
+#include <immintrin.h>
+#elif defined(GA_SSE2)
+#include <emmintrin.h>
+#endif
+
+// Batches with fewer queries than this per job are run on the calling thread.
+static const int k_parallel_query_min_points = 4096;
+static const int k_parallel_query_min_rays = 256;
+
+// The arrays of a frozen tree, as the query kernels read them.
+struct tree_view_t
+{
+	const float* _normal_x;
+	const float* _normal_y;
+	const float* _normal_z;
+	const float* _w;
+	const int32_t* _children;
+};
+
+// A point is inside when the walk down the tree falls off the back of a
+// node, and outside when it falls off the front, as in clip_polygons.
+static bool contains_one(const tree_view_t& tree, const ga_vec3f& point)
+{
+	int node = 0;
+	for (;;) {
+		float d = tree._normal_x[node] * point.x + tree._normal_y[node] * point.y + tree._normal_z[node] * point.z - tree._w[node];
+		int front = d > 0.0f ? 1 : 0;
+		int next = tree._children[2 * node + 1 - front];
+		if (next == ga_bsp_flat::k_none) return front == 0;
+		node = next;
+	}
+}
+
+static void contains_range(const tree_view_t& tree, const ga_vec3f* points, int count, bool* inside)
+{
+	int i = 0;
+
+	// Each lane walks the tree on its own. Lanes that have finished keep
+	// loading their last node, which is always in bounds, until every lane is done.
+#if defined(GA_AVX2)
+	{
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256i one = _mm256_set1_epi32(1);
+		const __m256i none = _mm256_set1_epi32(ga_bsp_flat::k_none);
+		const __m256i stride = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+		const float* p = reinterpret_cast<const float*>(points);
+
+		for (; i + 8 <= count; i += 8)
+		{
+			const float* base = p + i * 3;
+			__m256 x = _mm256_i32gather_ps(base + 0, stride, 4);
+			__m256 y = _mm256_i32gather_ps(base + 1, stride, 4);
+			__m256 z = _mm256_i32gather_ps(base + 2, stride, 4);
+
+			__m256i node = _mm256_setzero_si256();
+			int finished = 0;
+			int in = 0;
+			while (finished != 0xff)
+			{
+				__m256 nx = _mm256_i32gather_ps(tree._normal_x, node, 4);
+				__m256 ny = _mm256_i32gather_ps(tree._normal_y, node, 4);
+				__m256 nz = _mm256_i32gather_ps(tree._normal_z, node, 4);
+				__m256 w = _mm256_i32gather_ps(tree._w, node, 4);
+				__m256 d = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, x), _mm256_mul_ps(ny, y)), _mm256_mul_ps(nz, z)), w);
+				__m256 front = _mm256_cmp_ps(d, zero, _CMP_GT_OQ);
+
+				// Front lanes are all ones, so this picks child 2n for them and 2n + 1 otherwise.
+				__m256i slot = _mm256_add_epi32(_mm256_add_epi32(_mm256_add_epi32(node, node), one), _mm256_castps_si256(front));
+				__m256i next = _mm256_i32gather_epi32(tree._children, slot, 4);
+				__m256i leaf = _mm256_cmpeq_epi32(next, none);
+
+				int leaf_bits = _mm256_movemask_ps(_mm256_castsi256_ps(leaf)) & ~finished;
+				in |= leaf_bits & ~_mm256_movemask_ps(front);
+				finished |= leaf_bits;
+				node = _mm256_or_si256(_mm256_andnot_si256(leaf, next), _mm256_and_si256(leaf, node));
+			}
+			for (int j = 0; j < 8; ++j)
+			{
+				inside[i + j] = ((in >> j) & 1) != 0;
+			}
+		}
+	}
+#endif
+
+#if defined(GA_SSE2)
+	{
+		const __m128 zero = _mm_setzero_ps();
+
+		for (; i + 4 <= count; i += 4)
+		{
+			const ga_vec3f* q = points + i;
+			__m128 x = _mm_setr_ps(q[0].x, q[1].x, q[2].x, q[3].x);
+			__m128 y = _mm_setr_ps(q[0].y, q[1].y, q[2].y, q[3].y);
+			__m128 z = _mm_setr_ps(q[0].z, q[1].z, q[2].z, q[3].z);
+
+			// SSE2 has no gathers, so the planes are loaded and the children
+			// followed one lane at a time; the distances are computed together.
+			int node[4] = { 0, 0, 0, 0 };
+			int finished = 0;
+			int in = 0;
+			while (finished != 0xf)
+			{
+				__m128 nx = _mm_setr_ps(tree._normal_x[node[0]], tree._normal_x[node[1]], tree._normal_x[node[2]], tree._normal_x[node[3]]);
+				__m128 ny = _mm_setr_ps(tree._normal_y[node[0]], tree._normal_y[node[1]], tree._normal_y[node[2]], tree._normal_y[node[3]]);
+				__m128 nz = _mm_setr_ps(tree._normal_z[node[0]], tree._normal_z[node[1]], tree._normal_z[node[2]], tree._normal_z[node[3]]);
+				__m128 w = _mm_setr_ps(tree._w[node[0]], tree._w[node[1]], tree._w[node[2]], tree._w[node[3]]);
+				__m128 d = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, x), _mm_mul_ps(ny, y)), _mm_mul_ps(nz, z)), w);
+				int front_bits = _mm_movemask_ps(_mm_cmpgt_ps(d, zero));
+
+				for (int j = 0; j < 4; ++j)
+				{
+					if ((finished >> j) & 1) continue;
+					int front = (front_bits >> j) & 1;
+					int next = tree._children[2 * node[j] + 1 - front];
+					if (next == ga_bsp_flat::k_none) {
+						finished |= 1 << j;
+						if (!front) in |= 1 << j;
+					}
+					else {
+						node[j] = next;
+					}
+				}
+			}
+			for (int j = 0; j < 4; ++j)
+			{
+				inside[i + j] = ((in >> j) & 1) != 0;
+			}
+		}
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		inside[i] = contains_one(tree, points[i]);
+	}
+}
+
+// A stretch of a ray, from _t0 to _t1, still to be traced through the
+// subtree at _node. _normal is the surface normal at _t0, should the ray
+// turn out to be inside the solid there. A _node of k_none is a solid cell.
+struct trace_item_t
+{
+	int _node;
+	float _t0;
+	float _t1;
+	ga_vec3f _normal;
+};
+
+static ga_csg_ray_hit trace_one(const tree_view_t& tree, const ga_csg_ray& ray, std::vector<trace_item_t>& stack)
+{
+	ga_csg_ray_hit hit;
+	hit._hit = false;
+	hit._distance = 0.0f;
+	hit._normal = ga_vec3f::zero_vector();
+
+	// The far part of each split is pushed before the near part is traced,
+	// so the first solid cell reached is the nearest one.
+	stack.clear();
+	trace_item_t first;
+	first._node = 0;
+	first._t0 = 0.0f;
+	first._t1 = ray._max_distance;
+	first._normal = ga_vec3f::zero_vector();
+	stack.push_back(first);
+
+	while (!stack.empty()) {
+		trace_item_t item = stack.back();
+		stack.pop_back();
+
+		int node = item._node;
+		float t1 = item._t1;
+		for (;;) {
+			// Empty cells are never pushed or walked into, so this is a solid one.
+			if (node == ga_bsp_flat::k_none) {
+				hit._hit = true;
+				hit._distance = item._t0;
+				hit._normal = item._normal;
+				return hit;
+			}
+
+			ga_vec3f normal = { tree._normal_x[node], tree._normal_y[node], tree._normal_z[node] };
+			float start = normal.dot(ray._origin) - tree._w[node];
+			float rate = normal.dot(ray._direction);
+			float d0 = start + item._t0 * rate;
+			// Rays may be unbounded, and infinity times zero is not a number.
+			float d1 = (rate == 0.0f) ? d0 : start + t1 * rate;
+			bool front0 = d0 > 0.0f;
+			bool front1 = d1 > 0.0f;
+
+			int near_node = tree._children[2 * node + (front0 ? 0 : 1)];
+			if (front0 != front1) {
+				float t_split = std::min(std::max(-start / rate, item._t0), t1);
+				int far_node = tree._children[2 * node + (front0 ? 1 : 0)];
+				// Falling off the back of a node is entering the solid; falling
+				// off the front leaves nothing to hit.
+				if (far_node != ga_bsp_flat::k_none || front0) {
+					trace_item_t far_item;
+					far_item._node = far_node;
+					far_item._t0 = t_split;
+					far_item._t1 = t1;
+					far_item._normal = front0 ? normal : -normal;
+					stack.push_back(far_item);
+				}
+				t1 = t_split;
+			}
+
+			if (near_node == ga_bsp_flat::k_none && front0) break;
+			node = near_node;
+		}
+	}
+	return hit;
+}
+
+static void raycast_range(const tree_view_t& tree, const ga_csg_ray* rays, int count, ga_csg_ray_hit* hits)
+{
+	std::vector<trace_item_t> stack;
+	for (int i = 0; i < count; i++) {
+		hits[i] = trace_one(tree, rays[i], stack);
+	}
+}
+
+// Run a kernel over a batch of queries, split into runs across the job
+// system when the batch is large enough to be worth it.
+template<typename query_t, typename result_t>
+static void run_queries(const tree_view_t& tree, const query_t* queries, int count, result_t* results, int min_per_job,
+	void (*kernel)(const tree_view_t&, const query_t*, int, result_t*))
+{
+	struct query_data_t
+	{
+		const tree_view_t* _tree;
+		const query_t* _queries;
+		result_t* _results;
+		void (*_kernel)(const tree_view_t&, const query_t*, int, result_t*);
+	};
+	query_data_t query_data = { &tree, queries, results, kernel };
+	ga_csg_run_ranges<query_data_t>(count, min_per_job, &query_data,
+		[](query_data_t* data, int first, int end)
+	{
+		data->_kernel(*data->_tree, data->_queries + first, end - first, data->_results + first);
+	});
+}
+
+void ga_bsp_contains_points(
+	const ga_bsp_flat& bsp,
+	const ga_vec3f* points,
+	int count,
+	bool* inside)
+{
+	// An empty tree is an empty solid.
+	if (bsp.empty()) {
+		std::fill(inside, inside + count, false);
+		return;
+	}
+	tree_view_t tree = { bsp._normal_x.data(), bsp._normal_y.data(), bsp._normal_z.data(), bsp._w.data(), bsp._children.data() };
+	run_queries(tree, points, count, inside, k_parallel_query_min_points, contains_range);
+}
+
+void ga_bsp_raycast(
+	const ga_bsp_flat& bsp,
+	const ga_csg_ray* rays,
+	int count,
+	ga_csg_ray_hit* hits)
+{
+	if (bsp.empty()) {
+		for (int i = 0; i < count; i++) {
+			hits[i]._hit = false;
+			hits[i]._distance = 0.0f;
+			hits[i]._normal = ga_vec3f::zero_vector();
+		}
+		return;
+	}
+	tree_view_t tree = { bsp._normal_x.data(), bsp._normal_y.data(), bsp._normal_z.data(), bsp._w.data(), bsp._children.data() };
+	run_queries(tree, rays, count, hits, k_parallel_query_min_rays, raycast_range);
+}
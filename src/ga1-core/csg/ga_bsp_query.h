@@ -0,0 +1,68 @@
+#ifndef GA_BSP_QUERY_H
+#define GA_BSP_QUERY_H
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+** Evan Wallace - CSG.js - https://github.com/evanw/csg.js
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "math/ga_vec3f.h"
+
+#include <cmath>
+
+class ga_bsp_flat;
+
+/*
+** A ray cast against a solid. Distances are measured in multiples of
+** _direction, which are true distances when it has unit length.
+*/
+struct ga_csg_ray
+{
+	ga_vec3f _origin;
+	ga_vec3f _direction;
+	float _max_distance = INFINITY;
+};
+
+/*
+** Where a ray first enters a solid. _normal is the unit normal of the
+** surface there, facing back toward the ray's origin. A ray that starts
+** inside the solid hits it at distance 0, with a zero normal.
+*/
+struct ga_csg_ray_hit
+{
+	bool _hit;
+	float _distance;
+	ga_vec3f _normal;
+};
+
+/*
+** Find which points are inside the solid whose frozen BSP tree is bsp,
+** writing true to inside for each one that is. The tree is walked for
+** eight points at a time with AVX2, four with SSE2, and one at a time
+** otherwise. Large batches are split across the job system when it is
+** running. Points on the surface may land on either side.
+*/
+void ga_bsp_contains_points(
+	const ga_bsp_flat& bsp,
+	const ga_vec3f* points,
+	int count,
+	bool* inside);
+
+/*
+** Cast rays against the solid whose frozen BSP tree is bsp, filling one
+** hit per ray. The tree is walked front to back, so each ray stops at the
+** first solid cell it enters. Large batches are split across the job
+** system when it is running.
+*/
+void ga_bsp_raycast(
+	const ga_bsp_flat& bsp,
+	const ga_csg_ray* rays,
+	int count,
+	ga_csg_ray_hit* hits);
+
+#endif
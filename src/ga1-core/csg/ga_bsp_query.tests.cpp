@@ -0,0 +1,131 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+** Evan Wallace - CSG.js - https://github.com/evanw/csg.js
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_bsp_query.tests.h"
+#include "ga_bsp_query.h"
+
+#include "ga_csg.h"
+
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+static bool query_equal(float a, float b)
+{
+	return std::abs(a - b) <= 1e-5f;
+}
+
+void ga_bsp_query_unit_tests()
+{
+	// Points inside and outside a unit cube.
+	{
+		ga_csg cube = ga_csg::Cube();
+
+		assert(cube.contains_point({ 0.0f, 0.0f, 0.0f }));
+		assert(cube.contains_point({ 0.4f, -0.4f, 0.4f }));
+		assert(!cube.contains_point({ 0.6f, 0.0f, 0.0f }));
+		assert(!cube.contains_point({ 0.0f, 0.0f, -0.6f }));
+		assert(!cube.contains_point({ 2.0f, 2.0f, 2.0f }));
+
+		// Moving the cube moves the solid the points are tested against.
+		cube.set_pos({ 1.0f, 0.0f, 0.0f });
+		assert(cube.contains_point({ 1.4f, 0.0f, 0.0f }));
+		assert(!cube.contains_point({ 0.0f, 0.0f, 0.0f }));
+	}
+
+	// Rays against a unit cube.
+	{
+		ga_csg cube = ga_csg::Cube();
+		ga_csg_ray_hit hit;
+
+		// Straight at the -x face.
+		ga_csg_ray ray;
+		ray._origin = { -2.0f, 0.1f, 0.2f };
+		ray._direction = { 1.0f, 0.0f, 0.0f };
+		assert(cube.raycast(ray, hit));
+		assert(query_equal(hit._distance, 1.5f));
+		assert(hit._normal.equal({ -1.0f, 0.0f, 0.0f }));
+
+		// Distances are in multiples of the direction.
+		ray._direction = { 3.0f, 0.0f, 0.0f };
+		assert(cube.raycast(ray, hit));
+		assert(query_equal(hit._distance, 0.5f));
+		ray._direction = { 1.0f, 0.0f, 0.0f };
+
+		// Stopping short of the cube.
+		ray._max_distance = 1.0f;
+		assert(!cube.raycast(ray, hit));
+		ray._max_distance = INFINITY;
+
+		// Passing beside it.
+		ray._origin = { -2.0f, 0.6f, 0.0f };
+		assert(!cube.raycast(ray, hit));
+
+		// Down onto the +y face at an angle.
+		ray._origin = { 0.0f, 1.5f, 0.0f };
+		ray._direction = { 0.3f, -1.0f, 0.0f };
+		assert(cube.raycast(ray, hit));
+		assert(query_equal(hit._distance, 1.0f));
+		assert(hit._normal.equal({ 0.0f, 1.0f, 0.0f }));
+
+		// A ray that starts inside hits at once.
+		ray._origin = { 0.1f, 0.1f, 0.1f };
+		assert(cube.raycast(ray, hit));
+		assert(hit._distance == 0.0f);
+		assert(hit._normal.equal(ga_vec3f::zero_vector()));
+	}
+
+	// A batch of points, walked several at a time with AVX2 or SSE2 where
+	// they are enabled, lands the same as the points one at a time.
+	{
+		ga_csg sphere(ga_csg::Shape::SPHERE);
+		std::vector<ga_vec3f> points;
+		for (int x = 0; x < 17; x++) {
+			for (int y = 0; y < 13; y++) {
+				for (int z = 0; z < 11; z++) {
+					points.push_back({ -1.3f + 0.1637f * x, -1.2f + 0.2011f * y, -1.1f + 0.2273f * z });
+				}
+			}
+		}
+
+		std::vector<char> inside(points.size());
+		sphere.contains_points(points.data(), (int)points.size(), reinterpret_cast<bool*>(inside.data()));
+		int inside_count = 0;
+		for (size_t i = 0; i < points.size(); i++) {
+			assert((inside[i] != 0) == sphere.contains_point(points[i]));
+			inside_count += inside[i] != 0;
+		}
+		assert(inside_count > 0 && inside_count < (int)points.size());
+	}
+
+	// So do the rays of a batch.
+	{
+		ga_csg sphere(ga_csg::Shape::SPHERE);
+		std::vector<ga_csg_ray> rays(64);
+		for (int i = 0; i < (int)rays.size(); i++) {
+			rays[i]._origin = { -3.0f, -1.0f + i / 32.0f, 0.05f };
+			rays[i]._direction = { 1.0f, 0.0f, 0.0f };
+		}
+
+		std::vector<ga_csg_ray_hit> hits(rays.size());
+		sphere.raycast(rays.data(), (int)rays.size(), hits.data());
+		for (size_t i = 0; i < rays.size(); i++) {
+			ga_csg_ray_hit hit;
+			bool hit_one = sphere.raycast(rays[i], hit);
+			assert(hit_one == hits[i]._hit);
+			if (hit_one) {
+				assert(hit._distance == hits[i]._distance);
+				// Every hit is on the near side of the sphere.
+				assert(hit._distance > 1.9f && hit._distance <= 3.0f);
+				assert(hit._normal.x < 0.0f);
+			}
+		}
+	}
+}
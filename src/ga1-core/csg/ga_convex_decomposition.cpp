@@ -0,0 +1,582 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+** Evan Wallace - CSG.js - https://github.com/evanw/csg.js
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_convex_decomposition.h"
+#include "ga_csg_jobs.h"
+#include "ga_node.h"
+#include "ga_plane.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+// Jobs are handed at least this many cells, pieces or hulls.
+static const int k_parallel_decompose_min_items = 16;
+
+// Vertices closer than this are welded into one, and vertices closer than
+// this to a plane are on it. Larger than ga_csg_plane::EPSILON, since cell
+// corners are found by cutting edges once per face that shares them.
+static const float k_weld_distance = 1e-4f;
+
+// The box the cells are cut from is grown by this fraction of its diagonal,
+// so its faces never coincide with the solid's own.
+static const float k_box_padding = 1e-3f;
+
+// A convex cell as a list of faces, each a loop of vertices with its plane.
+// Face f is the vertices from _offsets[f] up to _offsets[f + 1].
+struct cell_t
+{
+	std::vector<ga_vec3f> _positions;
+	std::vector<int> _offsets;
+	std::vector<ga_csg_plane> _planes;
+};
+
+// A convex piece of the solid: everything behind all of _planes, whose
+// corners are _vertices. Pieces merged from ones that did not quite fit
+// reach up to _error outside the solid.
+struct piece_t
+{
+	std::vector<ga_csg_plane> _planes;
+	std::vector<ga_vec3f> _vertices;
+	ga_vec3f _min;
+	ga_vec3f _max;
+	float _error = 0.0f;
+};
+
+// A solid cell of the tree, as a run of steps from the root.
+struct leaf_t
+{
+	int _first;
+	int _count;
+};
+
+// How well two pieces fit together. _reach is how far the smallest convex
+// piece made of both reaches outside them; _plane_a and _plane_b are the
+// planes they meet across, or -1 if they do not.
+struct fit_t
+{
+	float _reach;
+	int _plane_a;
+	int _plane_b;
+};
+
+// A pair of pieces that could be merged, and how far outside the solid
+// the merged piece could reach.
+struct candidate_t
+{
+	int _a;
+	int _b;
+	fit_t _fit;
+	float _error;
+};
+
+// Remove points within k_weld_distance of an earlier one.
+static void weld(std::vector<ga_vec3f>& points)
+{
+	const float weld2 = k_weld_distance * k_weld_distance;
+	size_t count = 0;
+	for (size_t i = 0; i < points.size(); i++) {
+		bool duplicate = false;
+		for (size_t j = 0; j < count && !duplicate; j++) {
+			duplicate = points[i].dist2(points[j]) <= weld2;
+		}
+		if (!duplicate) points[count++] = points[i];
+	}
+	points.resize(count);
+}
+
+static void add_face(cell_t& cell, const ga_csg_plane& plane, const ga_vec3f* positions, int count)
+{
+	cell._positions.insert(cell._positions.end(), positions, positions + count);
+	cell._offsets.push_back((int)cell._positions.size());
+	cell._planes.push_back(plane);
+}
+
+static void make_box(const ga_vec3f& min, const ga_vec3f& max, cell_t& cell)
+{
+	ga_vec3f corners[8];
+	for (int i = 0; i < 8; i++) {
+		corners[i] = { (i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z };
+	}
+	// Corner indices of each face, counterclockwise seen from outside, then its normal.
+	static const int k_faces[6][4] = { { 0, 4, 6, 2 }, { 1, 3, 7, 5 }, { 0, 1, 5, 4 }, { 2, 6, 7, 3 }, { 0, 2, 3, 1 }, { 4, 5, 7, 6 } };
+	static const float k_normals[6][3] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+
+	cell._positions.clear();
+	cell._offsets.assign(1, 0);
+	cell._planes.clear();
+	for (int f = 0; f < 6; f++) {
+		ga_csg_plane plane;
+		plane._normal = { k_normals[f][0], k_normals[f][1], k_normals[f][2] };
+		plane._w = plane._normal.dot(corners[k_faces[f][0]]);
+		ga_vec3f face[4] = { corners[k_faces[f][0]], corners[k_faces[f][1]], corners[k_faces[f][2]], corners[k_faces[f][3]] };
+		add_face(cell, plane, face, 4);
+	}
+}
+
+// Close the hole a cut leaves in a cell with a face on the cutting plane,
+// through the points where the cut crossed the cell's edges.
+static void add_cap(const ga_csg_plane& plane, std::vector<ga_vec3f>& points, cell_t& cell)
+{
+	weld(points);
+	if (points.size() < 3) return;
+
+	ga_vec3f center = ga_vec3f::zero_vector();
+	for (const ga_vec3f& p : points) center += p;
+	center.scale(1.0f / points.size());
+
+	// The points are the corners of a convex polygon, so sorting them by
+	// angle around their center puts them in order.
+	const ga_vec3f& n = plane._normal;
+	ga_vec3f axis = (fabsf(n.x) < fabsf(n.y)) ? (fabsf(n.x) < fabsf(n.z) ? ga_vec3f::x_vector() : ga_vec3f::z_vector())
+		: (fabsf(n.y) < fabsf(n.z) ? ga_vec3f::y_vector() : ga_vec3f::z_vector());
+	ga_vec3f u = ga_vec3f_cross(n, axis).normal();
+	ga_vec3f v = ga_vec3f_cross(n, u);
+	std::vector<std::pair<float, int>> order(points.size());
+	for (size_t i = 0; i < points.size(); i++) {
+		ga_vec3f d = points[i] - center;
+		order[i] = std::make_pair(atan2f(d.dot(v), d.dot(u)), (int)i);
+	}
+	std::sort(order.begin(), order.end());
+
+	std::vector<ga_vec3f> face(points.size());
+	for (size_t i = 0; i < order.size(); i++) {
+		face[i] = points[order[i].second];
+	}
+	add_face(cell, plane, face.data(), (int)face.size());
+}
+
+// Cut away the part of cell in front of plane, writing what is left to out.
+// Returns false, without touching out, when nothing is in front of the plane.
+static bool clip_cell(const ga_csg_plane& plane, const cell_t& cell, cell_t& out, std::vector<ga_vec3f>& cap)
+{
+	const float eps = ga_csg_plane::EPSILON;
+	float min_d = INFINITY;
+	float max_d = -INFINITY;
+	for (const ga_vec3f& p : cell._positions) {
+		float d = plane._normal.dot(p) - plane._w;
+		min_d = std::min(min_d, d);
+		max_d = std::max(max_d, d);
+	}
+	if (max_d <= eps) return false;
+
+	out._positions.clear();
+	out._offsets.assign(1, 0);
+	out._planes.clear();
+	// Nothing is behind the plane, so nothing is left.
+	if (min_d >= -eps) return true;
+
+	cap.clear();
+	for (int f = 0; f < (int)cell._planes.size(); f++) {
+		int first = cell._offsets[f];
+		int end = cell._offsets[f + 1];
+		size_t start = out._positions.size();
+		for (int i = first; i < end; i++) {
+			const ga_vec3f& a = cell._positions[i];
+			const ga_vec3f& b = cell._positions[i + 1 < end ? i + 1 : first];
+			float da = plane._normal.dot(a) - plane._w;
+			float db = plane._normal.dot(b) - plane._w;
+			if (da <= eps) {
+				out._positions.push_back(a);
+				if (da >= -eps) cap.push_back(a);
+			}
+			if ((da < -eps && db > eps) || (da > eps && db < -eps)) {
+				ga_vec3f p = ga_vec3f_lerp(a, b, da / (da - db));
+				out._positions.push_back(p);
+				cap.push_back(p);
+			}
+		}
+		if (out._positions.size() - start >= 3) {
+			out._offsets.push_back((int)out._positions.size());
+			out._planes.push_back(cell._planes[f]);
+		}
+		else {
+			out._positions.resize(start);
+		}
+	}
+	add_cap(plane, cap, out);
+	return true;
+}
+
+static void set_bounds(piece_t& piece)
+{
+	piece._min = piece._max = piece._vertices.empty() ? ga_vec3f::zero_vector() : piece._vertices[0];
+	for (const ga_vec3f& p : piece._vertices) {
+		for (int axis = 0; axis < 3; axis++) {
+			piece._min.axes[axis] = std::min(piece._min.axes[axis], p.axes[axis]);
+			piece._max.axes[axis] = std::max(piece._max.axes[axis], p.axes[axis]);
+		}
+	}
+}
+
+// Cut the box down to one solid cell, along the planes on the path to it.
+static void build_piece(const ga_bsp_flat& bsp, const int32_t* steps, int count, const ga_vec3f& min, const ga_vec3f& max, piece_t& piece)
+{
+	cell_t cell;
+	cell_t next;
+	std::vector<ga_vec3f> cap;
+	make_box(min, max, cell);
+	// The planes nearest the cell bound it most closely, so cutting along
+	// them first keeps the cell small while the rest are tested against it.
+	for (int i = count - 1; i >= 0 && !cell._planes.empty(); i--) {
+		ga_csg_plane plane = bsp.get_plane(steps[i] >> 1);
+		if (steps[i] & 1) plane.flip();
+		if (clip_cell(plane, cell, next, cap)) std::swap(cell, next);
+	}
+
+	piece._planes = cell._planes;
+	piece._vertices = cell._positions;
+	weld(piece._vertices);
+	set_bounds(piece);
+}
+
+// Walk the tree depth first, recording the path to every solid cell: each
+// step is a node times two, plus one where the path goes to its front.
+// Falling off the back of a node is entering the solid.
+static void gather_leaves(const ga_bsp_flat& bsp, std::vector<int32_t>& steps, std::vector<leaf_t>& leaves)
+{
+	struct visit_t
+	{
+		int _node;
+		int _depth;
+		int32_t _step;
+	};
+
+	std::vector<int32_t> path;
+	std::vector<visit_t> stack;
+	stack.push_back({ 0, 0, -1 });
+	while (!stack.empty()) {
+		visit_t visit = stack.back();
+		stack.pop_back();
+		path.resize(std::max(visit._depth - 1, 0));
+		if (visit._depth > 0) path.push_back(visit._step);
+
+		int node = visit._node;
+		int back = bsp.get_back(node, false);
+		int front = bsp.get_front(node, false);
+		if (back == ga_bsp_flat::k_none) {
+			leaf_t leaf = { (int)steps.size(), (int)path.size() + 1 };
+			steps.insert(steps.end(), path.begin(), path.end());
+			steps.push_back(node * 2);
+			leaves.push_back(leaf);
+		}
+		else {
+			stack.push_back({ back, visit._depth + 1, node * 2 });
+		}
+		if (front != ga_bsp_flat::k_none) {
+			stack.push_back({ front, visit._depth + 1, node * 2 + 1 });
+		}
+	}
+}
+
+static bool opposite(const ga_csg_plane& a, const ga_csg_plane& b)
+{
+	return a._normal.dot(b._normal) < -1.0f + 1e-5f && fabsf(a._w + b._w) <= k_weld_distance;
+}
+
+static bool same(const ga_csg_plane& a, const ga_csg_plane& b)
+{
+	return a._normal.dot(b._normal) > 1.0f - 1e-5f && fabsf(a._w - b._w) <= k_weld_distance;
+}
+
+// How far the vertices reach in front of the plane.
+static float reach_past(const ga_csg_plane& plane, const std::vector<ga_vec3f>& vertices)
+{
+	float result = -INFINITY;
+	for (const ga_vec3f& p : vertices) {
+		result = std::max(result, plane._normal.dot(p) - plane._w);
+	}
+	return result;
+}
+
+// How far the vertices of b reach in front of the planes of a, other than skip.
+static float reach_past(const piece_t& a, int skip, const piece_t& b)
+{
+	float result = -INFINITY;
+	for (int i = 0; i < (int)a._planes.size(); i++) {
+		if (i != skip) result = std::max(result, reach_past(a._planes[i], b._vertices));
+	}
+	return result;
+}
+
+// Two pieces on either side of a plane they meet across make a convex
+// piece exactly when each lies behind all the other's remaining planes;
+// the piece is then everything behind those planes. How far either
+// reaches past them measures how far from convex the two are together.
+static fit_t fit_pieces(const piece_t& a, const piece_t& b)
+{
+	fit_t best = { INFINITY, -1, -1 };
+	for (int i = 0; i < (int)a._planes.size(); i++) {
+		for (int j = 0; j < (int)b._planes.size(); j++) {
+			if (!opposite(a._planes[i], b._planes[j])) continue;
+			float reach = std::max(reach_past(a, i, b), reach_past(b, j, a));
+			if (reach < best._reach) best = { reach, i, j };
+		}
+	}
+	if (best._plane_a < 0) {
+		best._reach = std::max(reach_past(a, -1, b), reach_past(b, -1, a));
+	}
+	return best;
+}
+
+// Add a plane of one piece to a merged piece, moved out just far enough to
+// cover the other piece, unless the merged piece already has it.
+static void add_merged_plane(const ga_csg_plane& plane, const piece_t& other, piece_t& out)
+{
+	ga_csg_plane moved = plane;
+	moved._w += std::max(reach_past(plane, other._vertices), 0.0f);
+	for (const ga_csg_plane& existing : out._planes) {
+		if (same(existing, moved)) return;
+	}
+	out._planes.push_back(moved);
+}
+
+static void merge_pieces(const piece_t& a, const piece_t& b, const fit_t& fit, piece_t& out)
+{
+	// Keep the planes of each piece, other than the one they meet across.
+	// When the pieces fit exactly, the other lies behind all of them and
+	// they bound the merged piece. Otherwise the planes the other reaches
+	// past are moved out to cover it, by no more than the fit's reach.
+	out._planes.clear();
+	for (int i = 0; i < (int)a._planes.size(); i++) {
+		if (i != fit._plane_a) add_merged_plane(a._planes[i], b, out);
+	}
+	for (int j = 0; j < (int)b._planes.size(); j++) {
+		if (j != fit._plane_b) add_merged_plane(b._planes[j], a, out);
+	}
+
+	out._vertices = a._vertices;
+	out._vertices.insert(out._vertices.end(), b._vertices.begin(), b._vertices.end());
+	weld(out._vertices);
+
+	// The corners of a convex piece each lie on at least three of its planes.
+	// Where the pieces met, the vertices on the shared face alone are no
+	// longer corners. Only when the pieces fit exactly do the planes say
+	// which vertices are corners.
+	if (fit._reach <= k_weld_distance) {
+		size_t count = 0;
+		for (size_t i = 0; i < out._vertices.size(); i++) {
+			int on = 0;
+			for (const ga_csg_plane& plane : out._planes) {
+				if (fabsf(plane._normal.dot(out._vertices[i]) - plane._w) <= k_weld_distance) on++;
+			}
+			if (on >= 3) out._vertices[count++] = out._vertices[i];
+		}
+		out._vertices.resize(count);
+	}
+	set_bounds(out);
+	out._error = std::max(a._error, b._error) + std::max(fit._reach, 0.0f);
+}
+
+// The planes of a piece merged from ones that did not quite fit reach
+// outside the solid by up to its error, and the fit is measured against
+// them, so the larger of the two pieces' errors is added to the fit.
+static candidate_t make_candidate(const std::vector<piece_t>& pieces, int a, int b)
+{
+	candidate_t candidate;
+	candidate._a = a;
+	candidate._b = b;
+	candidate._fit = fit_pieces(pieces[a], pieces[b]);
+	candidate._error = std::max(pieces[a]._error, pieces[b]._error) + std::max(candidate._fit._reach, 0.0f);
+	return candidate;
+}
+
+static bool bounds_touch(const piece_t& a, const piece_t& b)
+{
+	for (int axis = 0; axis < 3; axis++) {
+		if (a._min.axes[axis] > b._max.axes[axis] + k_weld_distance) return false;
+		if (a._max.axes[axis] < b._min.axes[axis] - k_weld_distance) return false;
+	}
+	return true;
+}
+
+// Keep at most max_vertices of the vertices: the one furthest along each of
+// a set of directions spread evenly over the sphere, with more directions
+// tried until the budget is spent.
+static void trim_vertices(std::vector<ga_vec3f>& vertices, int max_vertices)
+{
+	int count = (int)vertices.size();
+	if (count <= max_vertices) return;
+
+	// Radians between successive directions of a Fibonacci spiral.
+	const float golden_angle = 2.39996323f;
+	std::vector<char> keep(count, 0);
+	int kept = 0;
+	for (int directions = max_vertices; kept < max_vertices && directions <= 64 * max_vertices; directions *= 2) {
+		for (int k = 0; k < directions && kept < max_vertices; k++) {
+			float z = 1.0f - (2.0f * k + 1.0f) / directions;
+			float r = sqrtf(std::max(0.0f, 1.0f - z * z));
+			ga_vec3f dir = { r * cosf(golden_angle * k), r * sinf(golden_angle * k), z };
+			int best = 0;
+			float best_d = -INFINITY;
+			for (int i = 0; i < count; i++) {
+				float d = dir.dot(vertices[i]);
+				if (d > best_d) {
+					best_d = d;
+					best = i;
+				}
+			}
+			if (!keep[best]) {
+				keep[best] = 1;
+				kept++;
+			}
+		}
+	}
+
+	int out = 0;
+	for (int i = 0; i < count; i++) {
+		if (keep[i]) vertices[out++] = vertices[i];
+	}
+	vertices.resize(out);
+}
+
+void ga_decompose_convex(
+	const ga_bsp_flat& bsp,
+	const ga_vec3f& min,
+	const ga_vec3f& max,
+	const ga_convex_decomposition_options& options,
+	std::vector<ga_convex_hull>& hulls)
+{
+	hulls.clear();
+	if (bsp.empty()) return;
+
+	float diagonal = (max - min).mag();
+	ga_vec3f padding = ga_vec3f::one_vector().scale_result(diagonal * k_box_padding + k_weld_distance);
+	float tolerance = std::max(options._concavity * diagonal, k_weld_distance);
+	int max_hulls = std::max(options._max_hulls, 1);
+	int max_vertices = std::max(options._max_vertices, 4);
+
+	struct cell_data_t
+	{
+		const ga_bsp_flat* _bsp;
+		const std::vector<int32_t>* _steps;
+		const std::vector<leaf_t>* _leaves;
+		ga_vec3f _min;
+		ga_vec3f _max;
+		std::vector<piece_t>* _pieces;
+	};
+
+	std::vector<int32_t> steps;
+	std::vector<leaf_t> leaves;
+	gather_leaves(bsp, steps, leaves);
+
+	std::vector<piece_t> pieces(leaves.size());
+	cell_data_t cell_data = { &bsp, &steps, &leaves, min - padding, max + padding, &pieces };
+	ga_csg_run_ranges<cell_data_t>((int)leaves.size(), k_parallel_decompose_min_items, &cell_data,
+		[](cell_data_t* data, int first, int end)
+	{
+		for (int i = first; i < end; i++) {
+			const leaf_t& leaf = (*data->_leaves)[i];
+			build_piece(*data->_bsp, data->_steps->data() + leaf._first, leaf._count, data->_min, data->_max, (*data->_pieces)[i]);
+		}
+	});
+
+	// Cells that were cut down to nothing, or to something flat, are dropped.
+	pieces.erase(std::remove_if(pieces.begin(), pieces.end(), [](const piece_t& piece) { return piece._vertices.size() < 4; }), pieces.end());
+
+	// Pieces can only fit together if they touch, so only those pairs are
+	// considered until there is no other way to get down to max_hulls.
+	struct pair_data_t
+	{
+		const std::vector<piece_t>* _pieces;
+		std::vector<std::vector<candidate_t>> _candidates;
+	};
+
+	pair_data_t pair_data;
+	pair_data._pieces = &pieces;
+	pair_data._candidates.resize(pieces.size());
+	ga_csg_run_ranges<pair_data_t>((int)pieces.size(), k_parallel_decompose_min_items, &pair_data,
+		[](pair_data_t* data, int first, int end)
+	{
+		const std::vector<piece_t>& pieces = *data->_pieces;
+		for (int a = first; a < end; a++) {
+			for (int b = a + 1; b < (int)pieces.size(); b++) {
+				if (bounds_touch(pieces[a], pieces[b])) {
+					data->_candidates[a].push_back(make_candidate(pieces, a, b));
+				}
+			}
+		}
+	});
+
+	std::vector<candidate_t> candidates;
+	for (const std::vector<candidate_t>& from_piece : pair_data._candidates) {
+		candidates.insert(candidates.end(), from_piece.begin(), from_piece.end());
+	}
+
+	std::vector<char> alive(pieces.size(), 1);
+	int alive_count = (int)pieces.size();
+	bool all_pairs = false;
+	for (;;) {
+		int best = -1;
+		for (int i = 0; i < (int)candidates.size(); i++) {
+			if (best < 0 || candidates[i]._error < candidates[best]._error) best = i;
+		}
+
+		if (best < 0 || (candidates[best]._error > tolerance && alive_count <= max_hulls)) {
+			if (alive_count <= max_hulls || all_pairs) break;
+
+			// Too many pieces and none left touching: consider every pair.
+			all_pairs = true;
+			candidates.clear();
+			for (int a = 0; a < (int)pieces.size(); a++) {
+				for (int b = a + 1; b < (int)pieces.size(); b++) {
+					if (alive[a] && alive[b]) candidates.push_back(make_candidate(pieces, a, b));
+				}
+			}
+			continue;
+		}
+
+		candidate_t merge = candidates[best];
+		piece_t merged;
+		merge_pieces(pieces[merge._a], pieces[merge._b], merge._fit, merged);
+		alive[merge._a] = 0;
+		alive[merge._b] = 0;
+		alive_count--;
+
+		candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&alive](const candidate_t& candidate)
+		{
+			return !alive[candidate._a] || !alive[candidate._b];
+		}), candidates.end());
+
+		int index = (int)pieces.size();
+		pieces.push_back(std::move(merged));
+		alive.push_back(1);
+		for (int i = 0; i < index; i++) {
+			if (alive[i] && (all_pairs || bounds_touch(pieces[i], pieces[index]))) {
+				candidates.push_back(make_candidate(pieces, i, index));
+			}
+		}
+	}
+
+	struct hull_data_t
+	{
+		std::vector<piece_t*> _pieces;
+		std::vector<ga_convex_hull>* _hulls;
+		int _max_vertices;
+	};
+
+	hull_data_t hull_data;
+	for (size_t i = 0; i < pieces.size(); i++) {
+		if (alive[i]) hull_data._pieces.push_back(&pieces[i]);
+	}
+	hulls.resize(hull_data._pieces.size());
+	hull_data._hulls = &hulls;
+	hull_data._max_vertices = max_vertices;
+	ga_csg_run_ranges<hull_data_t>((int)hulls.size(), k_parallel_decompose_min_items, &hull_data,
+		[](hull_data_t* data, int first, int end)
+	{
+		for (int i = first; i < end; i++) {
+			std::vector<ga_vec3f>& vertices = data->_pieces[i]->_vertices;
+			trim_vertices(vertices, data->_max_vertices);
+			(*data->_hulls)[i]._positions = std::move(vertices);
+		}
+	});
+}
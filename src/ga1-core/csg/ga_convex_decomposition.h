@@ -0,0 +1,55 @@
+#ifndef GA_CONVEX_DECOMPOSITION_H
+#define GA_CONVEX_DECOMPOSITION_H
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+** Evan Wallace - CSG.js - https://github.com/evanw/csg.js
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "math/ga_vec3f.h"
+#include "physics/ga_shape.h"
+
+#include <vector>
+
+class ga_bsp_flat;
+
+/*
+** Limits on the convex hulls a solid is decomposed into.
+**
+** Pieces whose union reaches no further than _concavity outside it, as a
+** fraction of the diagonal of the solid's bounds, are always merged. Past
+** that, the pieces that fit each other best keep being merged until there
+** are no more than _max_hulls. Hulls with more than _max_vertices vertices
+** are trimmed to the ones furthest out in evenly spread directions, which
+** shrinks them slightly.
+*/
+struct ga_convex_decomposition_options
+{
+	int _max_hulls = 16;
+	int _max_vertices = 32;
+	float _concavity = 0.01f;
+};
+
+/*
+** Decompose the solid whose frozen BSP tree is bsp into convex hulls, for
+** collision against the solid without testing every polygon.
+**
+** Each solid cell of the tree is convex: it is the box from min to max,
+** the solid's bounds, cut by the planes on the path to it. The cells are
+** built, and the hulls trimmed, in parallel jobs when the job system is
+** running. The cells are then merged greedily, keeping each merged piece
+** convex as long as the limits in options allow.
+*/
+void ga_decompose_convex(
+	const ga_bsp_flat& bsp,
+	const ga_vec3f& min,
+	const ga_vec3f& max,
+	const ga_convex_decomposition_options& options,
+	std::vector<ga_convex_hull>& hulls);
+
+#endif
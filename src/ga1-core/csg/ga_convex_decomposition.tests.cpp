@@ -0,0 +1,98 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+** Evan Wallace - CSG.js - https://github.com/evanw/csg.js
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_convex_decomposition.tests.h"
+#include "ga_convex_decomposition.h"
+
+#include "ga_csg.h"
+
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+// Whether every vertex of the hull is a corner of the box from min to max,
+// and every corner is a vertex of the hull.
+static bool is_box_hull(const ga_convex_hull& hull, const ga_vec3f& min, const ga_vec3f& max)
+{
+	const float k_tolerance = 1e-4f;
+	if (hull._positions.size() != 8) return false;
+	int corners = 0;
+	for (const ga_vec3f& pos : hull._positions) {
+		int corner = 0;
+		for (int axis = 0; axis < 3; axis++) {
+			if (std::abs(pos.axes[axis] - min.axes[axis]) <= k_tolerance) continue;
+			if (std::abs(pos.axes[axis] - max.axes[axis]) > k_tolerance) return false;
+			corner |= 1 << axis;
+		}
+		corners |= 1 << corner;
+	}
+	return corners == 0xff;
+}
+
+void ga_convex_decomposition_unit_tests()
+{
+	// A cube is one hull of its eight corners.
+	{
+		ga_csg cube = ga_csg::Cube();
+		std::vector<ga_convex_hull> hulls;
+		cube.get_convex_hulls(hulls);
+
+		assert(hulls.size() == 1);
+		assert(is_box_hull(hulls[0], { -0.5f, -0.5f, -0.5f }, { 0.5f, 0.5f, 0.5f }));
+	}
+
+	// Hulls are in 3D space.
+	{
+		ga_csg box = ga_csg::Cube();
+		box.set_scale({ 2.0f, 1.0f, 0.5f });
+		box.set_pos({ 0.0f, 3.0f, 0.0f });
+		std::vector<ga_convex_hull> hulls;
+		box.get_convex_hulls(hulls);
+
+		assert(hulls.size() == 1);
+		assert(is_box_hull(hulls[0], { -1.0f, 2.5f, -0.25f }, { 1.0f, 3.5f, 0.25f }));
+	}
+
+	// Two cubes apart are never merged into one hull, which would fill the gap.
+	{
+		ga_csg a = ga_csg::Cube();
+		ga_csg b = ga_csg::Cube();
+		b.set_pos({ 2.0f, 0.0f, 0.0f });
+		ga_csg both = a.add(b);
+		std::vector<ga_convex_hull> hulls;
+		both.get_convex_hulls(hulls);
+
+		assert(hulls.size() == 2);
+		bool first_is_a = hulls[0]._positions[0].x < 1.0f;
+		const ga_convex_hull& hull_a = hulls[first_is_a ? 0 : 1];
+		const ga_convex_hull& hull_b = hulls[first_is_a ? 1 : 0];
+		assert(is_box_hull(hull_a, { -0.5f, -0.5f, -0.5f }, { 0.5f, 0.5f, 0.5f }));
+		assert(is_box_hull(hull_b, { 1.5f, -0.5f, -0.5f }, { 2.5f, 0.5f, 0.5f }));
+	}
+
+	// No more hulls, or vertices per hull, than the options allow.
+	{
+		ga_csg cube = ga_csg::Cube();
+		ga_csg cut = ga_csg::Cube();
+		cut.set_scale({ 0.5f, 2.0f, 0.5f });
+		ga_csg ring = cube.subtract(cut);
+
+		ga_convex_decomposition_options options;
+		options._max_hulls = 2;
+		options._max_vertices = 6;
+		std::vector<ga_convex_hull> hulls;
+		ring.get_convex_hulls(hulls, options);
+
+		assert(!hulls.empty() && hulls.size() <= 2);
+		for (const ga_convex_hull& hull : hulls) {
+			assert(hull._positions.size() >= 4 && hull._positions.size() <= 6);
+		}
+	}
+}
@@ -11,27 +11,29 @@
 ** This file is distributed under the MIT License. See LICENSE.txt.
 */
 //#include "entity/ga_component.h"
-#include "ga_csg_polygon.h"
+#include "ga_csg_mesh.h"
+#include "ga_csg_render_proxy.h"
 #include "framework/ga_frame_params.h"
 #include "graphics/ga_material.h"
 
+#include <memory>
+
 
 
 /// <summary>
 /// An abstract representation of CSG, complete with the Union, Subtract, and Intersect operations
 /// As well as modifications in space, such as translation, scale, and extrude.
-/// Uses VAOs as well as shaders to draw to the screen.
-/// Has name and color attributes as commodities. 
+/// The geometry lives in ga_csg_mesh; the VAO and shaders used to draw it to the screen
+/// live in a render proxy, created only once the csg is displayed.
+/// Has name and color attributes as commodities.
 /// </summary>
-class ga_csg
+class ga_csg : public ga_csg_mesh
 {
 public:
-	static enum class Shape { CUBE, SPHERE, PYRAMID };
-	static enum class OP { ADD, SUB, INTERSECT};
-
 	/// <summary>
 	/// Creates an instance of the ga_csg class, colored white, resembling the provided shape enum
 	/// Sets name to the name of the primitive
+	/// The polygons are shared with every other csg of that shape until either is given new ones
 	/// </summary>
 	/// <param name="shp"> The primitive shape to be created </param>
 	ga_csg(Shape shp);
@@ -39,9 +41,17 @@ public:
 	/// <summary>
 	/// Creates an instance of the ga_csg class with the same properties as another (color, polygons)
 	/// Sets name to the same name of the csg being copied
+	/// The polygons are shared, not copied
 	/// </summary>
 	/// <param name="other"> The ga_csg instance to be duplicated </param>
 	ga_csg(ga_csg& other);
+	/// <summary>
+	/// Takes the polygons, transform, color, name and render proxy of another csg,
+	/// leaving it empty
+	/// </summary>
+	/// <param name="other"> The ga_csg instance to be moved from </param>
+	ga_csg(ga_csg&& other);
+	ga_csg& operator=(ga_csg&& other);
 
 	/// <summary>
 	/// Creates an instance of the ga_csg class, colored white, from the specified polygons
@@ -49,61 +59,66 @@ public:
 	/// </summary>
 	/// <param name="polys"> A vector of polygons which create a mesh </param>
 	ga_csg(std::vector<ga_polygon>& polys);
-	~ga_csg() {
-		glDeleteVertexArrays(1, (GLuint*)&_vao);
-		glDeleteBuffers(3, _vbos);
-	};
 
-	
 	/// <summary>
-	/// Retrieve the CSG's polygons as they appear in unit-space
+	/// Creates an instance of the ga_csg class, colored white, from the specified polygon soup
+	/// Sets name to "Poly"
 	/// </summary>
-	/// <returns> Vector of polygons of the CSG centered at the origin, without transformations or scaling applied </returns>
-	std::vector<ga_polygon> get_polygons_raw() { return _polygons; };
-
+	/// <param name="polys"> A polygon soup which creates a mesh </param>
+	ga_csg(const ga_polygon_soup& polys);
+	ga_csg(ga_polygon_soup&& polys);
 	/// <summary>
-	/// Retrieve a certain CSG object's polygons with transformations
-	/// VERY computationally and memory intensive operation.
-	/// </summary>
-	/// <returns> Vector of polygons of the CSG with transformations and scalings applied </returns>
-	std::vector<ga_polygon> get_polygons() {
-		std::vector<ga_polygon> res;
-		for (int i = 0; i < _polygons.size(); i++) {
-			std::vector<ga_csg_vertex> temp_verts;
-			for (int j = 0; j < _polygons[i]._vertices.size(); j++) {
-				ga_vec3f old_pos = _polygons[i]._vertices[j]._pos;
-				ga_vec4f temp = { old_pos.x, old_pos.y, old_pos.z, 1.0f }; // might need to be 0.0
-				temp = _transform.transform(temp);
-				ga_vec3f new_pos = { temp.x, temp.y, temp.z };
-				temp_verts.push_back(ga_csg_vertex(new_pos, _polygons[i]._vertices[j]._normal));
-			}
-			res.push_back(ga_polygon(temp_verts));
-		}
-		return res;
-	}
+	/// Releases the render proxy, if any, so must be called where OpenGL is available
+	/// if the csg was ever displayed
+	/// </summary>
+	~ga_csg();
 
 	/// <summary>
-	/// Performs the Add operation on two CSG objects also represented 
+	/// Performs the Add operation on two CSG objects also represented
 	/// in the the form this + other.
 	/// </summary>
 	/// <param name="other"> The other csg to perform union with </param>
 	/// <returns> A new csg which has polygons of both csgs </returns>
 	ga_csg add(ga_csg& other);
 	/// <summary>
-	/// Performs the Subtract operation on two CSG objects also represented 
+	/// Performs the Subtract operation on two CSG objects also represented
 	/// in the the form this - other.
 	/// </summary>
 	/// <param name="other"> The other csg to perform union with </param>
 	/// <returns> A new csg which has polygons of both csgs </returns>
 	ga_csg subtract(ga_csg& other);
 	/// <summary>
-	/// Performs the Intersect operation on two CSG objects also represented 
+	/// Performs the Intersect operation on two CSG objects also represented
 	///	in the the form this XOR other.
 	/// </summary>
 	/// <param name="other"> The other csg to perform union with </param>
 	/// <returns> A new csg which has polygons of both csgs </returns>
 	ga_csg intersect(ga_csg& other);
 
+	/// <summary>
+	/// Performs the Add operation on any number of CSG objects
+	/// Operands are combined pairwise in a balanced tree, with independent pairs
+	/// running as parallel jobs when the job system is running
+	/// </summary>
+	/// <param name="csgs"> The csgs to combine; each may appear only once </param>
+	/// <returns> A new csg which has polygons of all csgs, colored with their average color </returns>
+	static ga_csg union_all(const std::vector<ga_csg*>& csgs);
+	/// <summary>
+	/// Performs the Intersect operation on any number of CSG objects
+	/// Operands are combined pairwise in a balanced tree, with independent pairs
+	/// running as parallel jobs when the job system is running
+	/// </summary>
+	/// <param name="csgs"> The csgs to combine; each may appear only once </param>
+	/// <returns> A new csg of the space inside all csgs, colored with their average color </returns>
+	static ga_csg intersect_all(const std::vector<ga_csg*>& csgs);
+
+	/// <summary>
+	/// Hash of everything that determines the csg's shape and look in 3D space:
+	/// its polygons, transform and color
+	/// </summary>
+	/// <returns> A hash which changes whenever the csg does </returns>
+	uint64_t get_hash();
+
 	/// <summary>
 	/// Creates a primitive unit length cube centered at the origin
 	/// </summary>
@@ -123,60 +138,37 @@ public:
 	/// Sets a new color for the csg
 	/// </summary>
 	/// <param name="col"> The new color to change to, following the format {r,g,b} </param>
-	void set_color(ga_vec3f col) { _color = col; _material->set_color(col); };
-	/// <summary>
-	/// Sets a new position for the csg
-	/// </summary>
-	/// <param name="col"> A position in 3D space, following the format {x,y,z} </param>
-	void set_pos(ga_vec3f t);
+	void set_color(ga_vec3f col);
 	/// <summary>
-	/// Sets a new scale for the csg
+	/// Obtain the color of the csg
 	/// </summary>
-	/// <param name="col"> The new scale of the object, following the format {x,y,z} </param>
-	void set_scale(ga_vec3f t);
+	/// <returns> The color, following the format {r,g,b} </returns>
+	ga_vec3f get_color() { return _color; };
 	/// <summary>
-	/// Extrudes an object in the specified direction (dir) an amount (amt)
+	/// Obtain the material of the object for modification
 	/// </summary>
-	/// <param name="dir">
-	/// The direction, or, "face" to extrude.
-	/// </param>
-	/// <param name="amt"> 
-	/// A value greater than 0, which resembles how much to extrude by
-	/// 0 < amt < 1 will extrude the object inwards by amt*100 percent
-	/// 1 < amt will extrude the object's face outwards by (1-amt)*100 percent
-	/// </param>
-	/// <remarks>
-	/// For example, calling extrude with the parameters (0,1,0) and (1.2) will make the
-	/// top of the object extend, leaving it unchanged in 3D space.
-	/// Calling extrude with the parameters (0,1,0) and (0.8) will instead make the top of the object 
-	/// extrude inwards.
-	/// </remarks>
-	void extrude(ga_vec3f dir, float amt);
+	/// <returns> A pointer to the material attached to this csg, or null if it has never been displayed </returns>
+	ga_csg_material* get_material() { return _proxy ? _proxy->get_material() : nullptr; };
+
 	/// <summary>
-	/// Obtain the transform matrix this object uses to appear in 3D space
+	/// Creates the render proxy if the csg has none, and uploads its polygons
+	/// if they changed since the last upload
+	/// Must be called where OpenGL is available
 	/// </summary>
-	/// <returns> A 4D matrix of floats representing translation and scale </returns>
-	ga_mat4f get_transform() { return _transform; };
+	/// <returns> The render proxy, owned by this csg </returns>
+	ga_csg_render_proxy* update_render_proxy();
 	/// <summary>
-	/// Obtain the material of the object for modification
+	/// Obtain the render proxy without creating or updating it
 	/// </summary>
-	/// <returns> A pointer to the material attached to this csg </returns>
-	ga_csg_material* get_material() { return _material; };
+	/// <returns> The render proxy, or null if the csg has never been displayed </returns>
+	ga_csg_render_proxy* get_render_proxy() { return _proxy.get(); };
 
 	std::string name;
 	int id;
 private:
-	uint32_t make_vao();
 	void default_values();
-	class ga_csg_material* _material;
-	uint32_t _vao;
-	GLsizei _index_count;
-	uint32_t _vbos[3];
 	ga_vec3f _color;
-	ga_mat4f _transform;
-	std::vector<ga_polygon> _polygons;
-
-	friend class ga_csg_component;
+	std::unique_ptr<ga_csg_render_proxy> _proxy;
 };
 
-#endif
\ No newline at end of file
+#endif
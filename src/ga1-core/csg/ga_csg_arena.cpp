@@ -0,0 +1,107 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_csg_arena.h"
+
+#include <cstdint>
+#include <cstdlib>
+
+ga_csg_arena::ga_csg_arena(size_t block_size)
+{
+	_blocks = nullptr;
+	_destructors = nullptr;
+	_block_size = block_size;
+	_bytes_used = 0;
+}
+
+ga_csg_arena::~ga_csg_arena()
+{
+	reset();
+	free(_blocks);
+}
+
+void* ga_csg_arena::alloc(size_t size, size_t align)
+{
+	while (_lock.test_and_set(std::memory_order_acquire)) {}
+	void* mem = alloc_locked(size, align);
+	_lock.clear(std::memory_order_release);
+	return mem;
+}
+
+void* ga_csg_arena::alloc_locked(size_t size, size_t align)
+{
+	block_t* block = _blocks;
+	if (block)
+	{
+		uintptr_t base = reinterpret_cast<uintptr_t>(block + 1);
+		uintptr_t start = (base + block->_used + align - 1) & ~(uintptr_t)(align - 1);
+		if (start + size <= base + block->_size)
+		{
+			block->_used = start + size - base;
+			_bytes_used += size;
+			return reinterpret_cast<void*>(start);
+		}
+	}
+
+	// Current block is full: start a new one large enough for the request.
+	block = new_block(size + align);
+	uintptr_t base = reinterpret_cast<uintptr_t>(block + 1);
+	uintptr_t start = (base + align - 1) & ~(uintptr_t)(align - 1);
+	block->_used = start + size - base;
+	_bytes_used += size;
+	return reinterpret_cast<void*>(start);
+}
+
+void ga_csg_arena::reset()
+{
+	// Destroy in reverse order of construction.
+	for (destructor_t* d = _destructors; d; d = d->_next)
+	{
+		d->_function(d->_object);
+	}
+	_destructors = nullptr;
+
+	if (_blocks)
+	{
+		block_t* block = _blocks->_next;
+		while (block)
+		{
+			block_t* next = block->_next;
+			free(block);
+			block = next;
+		}
+		_blocks->_next = nullptr;
+		_blocks->_used = 0;
+	}
+	_bytes_used = 0;
+}
+
+void ga_csg_arena::add_destructor(void(*function)(void*), void* object)
+{
+	while (_lock.test_and_set(std::memory_order_acquire)) {}
+	destructor_t* d = static_cast<destructor_t*>(alloc_locked(sizeof(destructor_t), alignof(destructor_t)));
+	d->_function = function;
+	d->_object = object;
+	d->_next = _destructors;
+	_destructors = d;
+	_lock.clear(std::memory_order_release);
+}
+
+ga_csg_arena::block_t* ga_csg_arena::new_block(size_t min_size)
+{
+	size_t size = min_size > _block_size ? min_size : _block_size;
+	block_t* block = static_cast<block_t*>(malloc(sizeof(block_t) + size));
+	block->_size = size;
+	block->_used = 0;
+
+	// Keep the newest block at the head so allocation always bumps from it.
+	block->_next = _blocks;
+	_blocks = block;
+	return block;
+}
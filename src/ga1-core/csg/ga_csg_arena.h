@@ -0,0 +1,102 @@
+#ifndef GA_CSG_ARENA_H
+#define GA_CSG_ARENA_H
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/*
+** A bump allocator for the transient data of a single CSG operation.
+** Only the BSP nodes themselves (and any flat trees frozen from them) are
+** carved out of its large contiguous blocks, so the nodes of a tree stay
+** close together in memory. The polygon soups the nodes hold keep their
+** columns and shared plane table on the heap; the arena runs their
+** destructors, which free them. Nothing is freed individually: everything
+** goes away at once on reset() or when the arena is destroyed.
+**
+** Allocation is guarded by a spin lock so subtrees can be built from jobs.
+*/
+class ga_csg_arena
+{
+public:
+	static const size_t k_default_block_size = 64 * 1024;
+
+	ga_csg_arena(size_t block_size = k_default_block_size);
+	~ga_csg_arena();
+
+	/*
+	** Allocate raw, uninitialized memory from the arena.
+	*/
+	void* alloc(size_t size, size_t align);
+
+	/*
+	** Construct an object in the arena.
+	** Objects with non-trivial destructors are destroyed on reset().
+	*/
+	template<typename T, typename... Args>
+	T* create(Args&&... args)
+	{
+		void* mem = alloc(sizeof(T), alignof(T));
+		T* object = new (mem) T(std::forward<Args>(args)...);
+		if (!std::is_trivially_destructible<T>::value)
+		{
+			add_destructor(&ga_csg_arena::destroy<T>, object);
+		}
+		return object;
+	}
+
+	/*
+	** Destroy every object created in the arena and release all blocks
+	** except the most recent one, which is kept for reuse.
+	*/
+	void reset();
+
+	/*
+	** Total number of bytes handed out since the last reset.
+	*/
+	size_t get_bytes_used() const { return _bytes_used; }
+
+private:
+	struct block_t
+	{
+		block_t* _next;
+		size_t _size;
+		size_t _used;
+	};
+
+	struct destructor_t
+	{
+		void (*_function)(void* object);
+		void* _object;
+		destructor_t* _next;
+	};
+
+	template<typename T>
+	static void destroy(void* object) { static_cast<T*>(object)->~T(); }
+
+	void* alloc_locked(size_t size, size_t align);
+	void add_destructor(void (*function)(void*), void* object);
+	block_t* new_block(size_t min_size);
+
+	block_t* _blocks;
+	destructor_t* _destructors;
+	size_t _block_size;
+	size_t _bytes_used;
+	std::atomic_flag _lock = ATOMIC_FLAG_INIT;
+
+	ga_csg_arena(const ga_csg_arena&) = delete;
+	ga_csg_arena& operator=(const ga_csg_arena&) = delete;
+};
+
+#endif
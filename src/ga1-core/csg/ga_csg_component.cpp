@@ -15,45 +15,119 @@ ga_csg_component::ga_csg_component(class ga_entity* ent, ga_csg::Shape which_sha
     _csgs[0]->set_pos(translation);
     _csgs[0]->set_color(color);
     _csgs[0]->id = get_id();
+    _csgs[0]->update_render_proxy();
 }
 
-ga_csg_component::ga_csg_component(class ga_entity* ent, ga_csg& csg1, ga_csg& csg2, ga_csg::OP op) : ga_component(ent) {
-    
-    ga_csg* temp = NULL;
-    switch (op) {
-    case ga_csg::OP::ADD:
-        temp = new ga_csg(csg1.add(csg2));
-        break;
-    case ga_csg::OP::SUB:
-        break;
-    case ga_csg::OP::INTERSECT:
-        break;
-    default:
-        exit(0);
-    }
+ga_csg_component::ga_csg_component(class ga_entity* ent, ga_csg& csg1, ga_csg& csg2, ga_csg::OP op) :
+    ga_csg_component(ent, ga_csg_expr::op(op, ga_csg_expr::leaf(&csg1), ga_csg_expr::leaf(&csg2))) {
+}
+
+ga_csg_component::ga_csg_component(class ga_entity* ent, std::shared_ptr<ga_csg_expr> expr) : ga_component(ent) {
+    _expr = expr;
+    ga_csg* temp = _expr->evaluate();
     temp->id = get_id();
+    temp->update_render_proxy();
     _csgs.push_back(temp);
-    
 }
 
 ga_csg_component::~ga_csg_component() {
-    for (int i = 0; i < _csgs.size(); i++) delete _csgs[i];
+    // Operations still running wait for their jobs as they are released.
+    _operations.clear();
+    // The expression's result belongs to the expression.
+    for (int i = 0; i < _csgs.size(); i++) {
+        if (_expr && _csgs[i] == _expr->get_result()) continue;
+        delete _csgs[i];
+    }
+}
+
+void ga_csg_component::evaluate() {
+    if (!_expr) return;
+    _expr->evaluate()->update_render_proxy();
+}
+
+void ga_csg_component::add(ga_csg* csg) {
+    csg->update_render_proxy();
+    _csgs.push_back(csg);
+}
+
+std::shared_ptr<ga_csg_operation> ga_csg_component::submit(ga_csg& csg1, ga_csg& csg2, ga_csg::OP op,
+    ga_csg_operation::Mode mode) {
+    std::shared_ptr<ga_csg_operation> operation = std::make_shared<ga_csg_operation>(csg1, csg2, op, mode);
+    _operations.push_back(operation);
+    start_operations();
+    return operation;
+}
+
+void ga_csg_component::finish_operations() {
+    for (int i = 0; i < _operations.size();) {
+        ga_csg_operation* operation = _operations[i].get();
+        // A cancelled job still has to finish before it can be released, unless
+        // it never started.
+        bool dropped = operation->is_cancelled() &&
+            (operation->get_mode() == ga_csg_operation::Mode::TIME_SLICED ||
+             !operation->is_started() || operation->is_computed());
+        if (dropped) {
+            _operations.erase(_operations.begin() + i);
+            continue;
+        }
+        if (!operation->is_computed()) {
+            i++;
+            continue;
+        }
+        ga_csg* temp = _operations[i]->create_result();
+        temp->id = get_id();
+        add(temp);
+        _operations.erase(_operations.begin() + i);
+    }
+    start_operations();
+}
+
+void ga_csg_component::start_operations() {
+    int running = 0;
+    for (int i = 0; i < _operations.size(); i++) {
+        ga_csg_operation* operation = _operations[i].get();
+        if (operation->get_mode() != ga_csg_operation::Mode::JOB) continue;
+        if (operation->is_started() && !operation->is_computed()) running++;
+    }
+    for (int i = 0; i < _operations.size() && running < k_max_running_jobs; i++) {
+        ga_csg_operation* operation = _operations[i].get();
+        if (operation->get_mode() != ga_csg_operation::Mode::JOB) continue;
+        if (operation->is_started() || operation->is_cancelled()) continue;
+        operation->start();
+        // Without the job system an operation is computed as it starts.
+        if (!operation->is_computed()) running++;
+    }
 }
 
 void ga_csg_component::update(ga_frame_params* params) {
     float dt = std::chrono::duration_cast<std::chrono::duration<float>>(params->_delta_time).count();
+
+    if (!_operations.empty()) {
+        auto deadline = std::chrono::steady_clock::now() +
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float, std::milli>(_time_budget_ms));
+        for (int i = 0; i < _operations.size(); i++) {
+            ga_csg_operation* operation = _operations[i].get();
+            if (operation->get_mode() != ga_csg_operation::Mode::TIME_SLICED) continue;
+            if (operation->is_computed() || operation->is_cancelled()) continue;
+            if (!operation->advance(deadline)) break;
+        }
+    }
     
     std::vector<ga_static_drawcall> draws;
     for (int i = 0; i < _csgs.size(); i++) {
+        // Proxies are only created where OpenGL is available, never from update.
+        ga_csg_render_proxy* proxy = _csgs[i]->get_render_proxy();
+        if (!proxy) continue;
         ga_static_drawcall draw;
         draw._name = _csgs[i]->name;
         draw._transform = get_entity()->get_transform();
         draw._draw_mode = GL_TRIANGLES;
         //_csg->assemble_drawcall(draw);    
-        draw._vao = _csgs[i]->_vao;
-        draw._index_count = _csgs[i]->_index_count;
-        _csgs[i]->_material->set_transform(_csgs[i]->_transform);
-        draw._material = _csgs[i]->_material;
+        draw._vao = proxy->get_vao();
+        draw._index_count = proxy->get_index_count();
+        draw._index_type = proxy->get_index_type();
+        proxy->get_material()->set_transform(_csgs[i]->get_transform());
+        draw._material = proxy->get_material();
         draws.push_back(draw);
     }    
     while (params->_static_drawcall_lock.test_and_set(std::memory_order_acquire)) {}
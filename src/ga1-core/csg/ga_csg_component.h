@@ -13,8 +13,11 @@
 #include "entity/ga_component.h"
 #include "entity/ga_entity.h"
 #include "ga_csg.h"
+#include "ga_csg_expr.h"
+#include "ga_csg_operation.h"
 
 #include <cstdint>
+#include <memory>
 #include <string>
 
 /// <summary>
@@ -35,16 +38,24 @@ public:
 	ga_csg_component(ga_entity* ent, ga_csg::Shape which_shape, ga_vec3f translation = { 0.0f,0.0f,0.0f }, ga_vec3f color = { 1.0f,1.0f,1.0f });
 	/// <summary>
 	/// Initializes a component with the resultant of performing csg1 op csg2
+	/// The operation is kept as an expression, see evaluate()
 	/// </summary>
 	/// <param name="ent"> A pointer to the entity to which this component gets added to </param>
 	/// <param name="csg1"> A reference to the csg object which is performing the operation </param>
 	/// <param name="csg2"> A reference to the csg object which is the second argument in the operation </param>
 	/// <param name="op"> An enum specifying which operation to be performed </param>
 	ga_csg_component(ga_entity* ent, ga_csg& csg1, ga_csg& csg2, ga_csg::OP op = ga_csg::OP::ADD);
+	/// <summary>
+	/// Initializes a component with the resultant of a csg expression
+	/// </summary>
+	/// <param name="ent"> A pointer to the entity to which this component gets added to </param>
+	/// <param name="expr"> The root of the expression DAG to evaluate </param>
+	ga_csg_component(ga_entity* ent, std::shared_ptr<ga_csg_expr> expr);
 	virtual ~ga_csg_component();
 	
 	/// <summary>
-	/// Assembles drawcalls for all the csgs in its possession, pushing them onto the draw stack
+	/// Advances time-sliced operations for up to the time budget, then
+	/// assembles drawcalls for all the csgs in its possession, pushing them onto the draw stack
 	/// </summary>
 	/// <param name="params"></param>
 	virtual void update(struct ga_frame_params* params) override;
@@ -54,6 +65,51 @@ public:
 	/// <param name="params"></param>
 	virtual void late_update(struct ga_frame_params* params) override;
 
+	/// <summary>
+	/// Re-evaluates the component's expression, if it has one, recomputing only
+	/// the operations whose inputs changed since the last evaluation.
+	/// The result stays at index 0 and keeps its transform, and its vertex
+	/// array is uploaded again if its polygons changed.
+	/// Must be called where OpenGL is available, not from update.
+	/// </summary>
+	void evaluate();
+	/// <summary>
+	/// Starts computing csg1 op csg2 in the background, returning at once
+	/// The result is added to this component by finish_operations once it is ready.
+	/// At most k_max_running_jobs JOB operations run at once; later ones are queued
+	/// and started, oldest first, by finish_operations as running ones finish.
+	/// </summary>
+	/// <param name="csg1"> The csg which is performing the operation </param>
+	/// <param name="csg2"> The csg which is the second argument in the operation </param>
+	/// <param name="op"> An enum specifying which operation to be performed </param>
+	/// <param name="mode"> Whether to run as a job, or a slice at a time from update </param>
+	/// <returns> A handle to the operation, which yields the result once it is done </returns>
+	std::shared_ptr<ga_csg_operation> submit(ga_csg& csg1, ga_csg& csg2, ga_csg::OP op = ga_csg::OP::ADD,
+		ga_csg_operation::Mode mode = ga_csg_operation::Mode::JOB);
+	/// <summary>
+	/// Adds the results of submitted operations which have finished, uploading their vertex arrays,
+	/// drops operations which were cancelled, and starts queued jobs in the slots freed
+	/// Never waits for operations still running. Call once a frame, where OpenGL is available.
+	/// </summary>
+	void finish_operations();
+	/// <summary>
+	/// Sets how long update may spend each frame advancing time-sliced operations
+	/// The budget is shared by all of them, oldest first, and is only ever overrun by a single step
+	/// </summary>
+	/// <param name="ms"> The budget in milliseconds </param>
+	void set_time_budget(float ms) { _time_budget_ms = ms; };
+	/// <summary>
+	/// Obtain how long update may spend each frame advancing time-sliced operations
+	/// </summary>
+	/// <returns> The budget in milliseconds </returns>
+	float get_time_budget() { return _time_budget_ms; };
+
+	/// <summary>
+	/// Accessor for the root of the component's expression
+	/// </summary>
+	/// <returns> The expression, or null for components made from a primitive </returns>
+	std::shared_ptr<ga_csg_expr> get_expr() { return _expr; };
+
 	/// <summary>
 	/// Accessor which retrieves a csg component's child csg at the specified index
 	/// </summary>
@@ -61,10 +117,11 @@ public:
 	/// <returns> A pointer to the csg object located at that index. </returns>
 	ga_csg* get_csg(int i = 0) { return _csgs[i]; };
 	/// <summary>
-	/// Adds a csg to the list of owned csg children
+	/// Adds a csg to the list of owned csg children, creating its render proxy
+	/// Must be called where OpenGL is available, not from update.
 	/// </summary>
 	/// <param name="csg"> Pointer to csg object to be added </param>
-	void add(ga_csg* csg) { _csgs.push_back(csg); }
+	void add(ga_csg* csg);
 	/// <summary>
 	/// Removes a csg from the list of owned csgs
 	/// </summary>
@@ -81,8 +138,21 @@ public:
 	/// <returns> the id to assign to the newly added CSG </returns>
 	int get_id() { return nonce++; }
 
+	/// <summary>
+	/// JOB operations of one component which may run at once. Each may hold up to 64
+	/// fibers in jobs waiting on the ones they fork, and the job system spins once its
+	/// pool is used up, so the rest wait in the queue instead.
+	/// </summary>
+	static const int k_max_running_jobs = 2;
+
 private:
+	// Starts queued JOB operations, oldest first, while fewer than k_max_running_jobs run.
+	void start_operations();
+
 	std::vector<ga_csg*> _csgs;
+	std::shared_ptr<ga_csg_expr> _expr;
+	std::vector<std::shared_ptr<ga_csg_operation>> _operations;
 	int index_to_remove;
 	int nonce = 0;
+	float _time_budget_ms = 4.0f;
 };
@@ -0,0 +1,113 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+** Evan Wallace - CSG.js - https://github.com/evanw/csg.js
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_csg_expr.h"
+
+#include <utility>
+
+// Expressions are evaluated on one thread, so a plain counter is enough.
+static uint32_t expr_hash_epoch = 0;
+
+std::shared_ptr<ga_csg_expr> ga_csg_expr::leaf(ga_csg* csg)
+{
+	std::shared_ptr<ga_csg_expr> node(new ga_csg_expr(Type::LEAF));
+	node->_leaf = csg;
+	return node;
+}
+
+std::shared_ptr<ga_csg_expr> ga_csg_expr::transform(std::shared_ptr<ga_csg_expr> child, const ga_mat4f& transform)
+{
+	std::shared_ptr<ga_csg_expr> node(new ga_csg_expr(Type::TRANSFORM));
+	node->_a = child;
+	node->_transform = transform;
+	return node;
+}
+
+std::shared_ptr<ga_csg_expr> ga_csg_expr::op(ga_csg::OP op, std::shared_ptr<ga_csg_expr> a, std::shared_ptr<ga_csg_expr> b)
+{
+	std::shared_ptr<ga_csg_expr> node(new ga_csg_expr(Type::OP));
+	node->_op = op;
+	node->_a = a;
+	node->_b = b;
+	return node;
+}
+
+uint64_t ga_csg_expr::get_hash()
+{
+	return get_hash(++expr_hash_epoch);
+}
+
+uint64_t ga_csg_expr::get_hash(uint32_t epoch)
+{
+	if (_type == Type::LEAF) return _leaf->get_hash();
+
+	// Parents see the result as it appears in 3D space, so its own transform counts too.
+	ga_mat4f transform;
+	if (_result) transform = _result->get_transform();
+	else transform.make_identity();
+	return ga_csg_hash(&transform, sizeof(transform), get_input_hash(epoch));
+}
+
+uint64_t ga_csg_expr::get_input_hash(uint32_t epoch)
+{
+	if (_input_hash_epoch == epoch) return _input_hash;
+
+	if (_type == Type::TRANSFORM) {
+		_input_hash = ga_csg_hash(&_transform, sizeof(_transform), _a->get_hash(epoch));
+	}
+	else {
+		uint64_t hash = ga_csg_hash(&_op, sizeof(_op), _a->get_hash(epoch));
+		uint64_t b_hash = _b->get_hash(epoch);
+		_input_hash = ga_csg_hash(&b_hash, sizeof(b_hash), hash);
+	}
+	_input_hash_epoch = epoch;
+	return _input_hash;
+}
+
+ga_csg* ga_csg_expr::evaluate()
+{
+	return evaluate(++expr_hash_epoch);
+}
+
+ga_csg* ga_csg_expr::evaluate(uint32_t epoch)
+{
+	if (_type == Type::LEAF) return _leaf;
+
+	uint64_t hash = get_input_hash(epoch);
+	if (_result && hash == _result_hash) return _result.get();
+
+	ga_polygon_soup polys;
+	ga_vec3f color;
+	bool convex;
+	ga_csg* a = _a->evaluate(epoch);
+	if (_type == Type::TRANSFORM) {
+		polys = a->get_polygon_soup();
+		polys.transform(_transform);
+		color = a->get_color();
+		convex = a->is_convex();
+	}
+	else {
+		ga_csg* b = _b->evaluate(epoch);
+		switch (_op) {
+		case ga_csg::OP::ADD: polys = a->add_polygons(*b); break;
+		case ga_csg::OP::SUB: polys = a->subtract_polygons(*b); break;
+		case ga_csg::OP::INTERSECT: polys = a->intersect_polygons(*b); break;
+		}
+		color = ga_vec3f_lerp(a->get_color(), b->get_color(), 0.5);
+		convex = _op == ga_csg::OP::INTERSECT && a->is_convex() && b->is_convex();
+	}
+
+	if (!_result) _result.reset(new ga_csg(std::move(polys)));
+	else _result->set_polygons(std::move(polys));
+	_result->set_color(color);
+	_result->set_convex(convex);
+	_result_hash = hash;
+	return _result.get();
+}
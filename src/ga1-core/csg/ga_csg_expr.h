@@ -0,0 +1,112 @@
+#ifndef GA_CSG_EXPR_H
+#define GA_CSG_EXPR_H
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+** Evan Wallace - CSG.js - https://github.com/evanw/csg.js
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_csg.h"
+#include "math/ga_mat4f.h"
+
+#include <cstdint>
+#include <memory>
+
+/// <summary>
+/// A node in a CSG expression DAG: a leaf solid, a transformed sub-expression,
+/// or the Add, Subtract or Intersect of two sub-expressions.
+/// Nodes may be shared by several parents, and are evaluated lazily.
+/// </summary>
+/// <remarks>
+/// Each node remembers the hash of its inputs from its last evaluation. Evaluating
+/// a node only recomputes it when that hash has changed, so editing one leaf only
+/// recomputes the operations on the path from that leaf to the root.
+/// The result of a node is a single csg which is updated in place, so pointers to
+/// it stay valid across evaluations. Its own transform is kept when it is updated.
+/// Input hashes are stored per evaluation pass, so a node shared by several parents
+/// is hashed once per pass rather than once per path to it.
+/// </remarks>
+class ga_csg_expr
+{
+public:
+	enum class Type { LEAF, TRANSFORM, OP };
+
+	/// <summary>
+	/// Creates a leaf node which evaluates to an existing csg
+	/// </summary>
+	/// <param name="csg"> The csg to read from; it is not owned and must outlive the node </param>
+	/// <returns> The new node </returns>
+	static std::shared_ptr<ga_csg_expr> leaf(ga_csg* csg);
+	/// <summary>
+	/// Creates a node which evaluates to another node transformed by a matrix
+	/// </summary>
+	/// <param name="child"> The node to transform </param>
+	/// <param name="transform"> The matrix applied to the child's polygons in 3D space </param>
+	/// <returns> The new node </returns>
+	static std::shared_ptr<ga_csg_expr> transform(std::shared_ptr<ga_csg_expr> child, const ga_mat4f& transform);
+	/// <summary>
+	/// Creates a node which evaluates to a op b
+	/// </summary>
+	/// <param name="op"> The operation to perform </param>
+	/// <param name="a"> The node performing the operation </param>
+	/// <param name="b"> The node which is the second argument of the operation </param>
+	/// <returns> The new node </returns>
+	static std::shared_ptr<ga_csg_expr> op(ga_csg::OP op, std::shared_ptr<ga_csg_expr> a, std::shared_ptr<ga_csg_expr> b);
+
+	/// <summary>
+	/// Evaluates the node, recomputing only the parts of the DAG below it whose inputs changed
+	/// Makes no OpenGL calls; results which are displayed upload their new polygons
+	/// when their render proxy is next updated
+	/// </summary>
+	/// <returns> The result of the node, owned by the node (or the leaf csg itself) </returns>
+	ga_csg* evaluate();
+
+	/// <summary>
+	/// Obtain the result of the last evaluation without evaluating again
+	/// </summary>
+	/// <returns> The result, or null if the node has never been evaluated </returns>
+	ga_csg* get_result() { return (_type == Type::LEAF) ? _leaf : _result.get(); };
+
+	/// <summary>
+	/// Hash of every input of the node, computed from the leaves up
+	/// </summary>
+	/// <returns> A hash which changes whenever the result of the node, as it appears in 3D space, would </returns>
+	uint64_t get_hash();
+
+	/// <summary>
+	/// Sets the matrix of a transform node, marking the paths through it dirty
+	/// </summary>
+	/// <param name="transform"> The new matrix </param>
+	void set_transform(const ga_mat4f& transform) { _transform = transform; };
+
+	Type get_type() { return _type; };
+
+private:
+	ga_csg_expr(Type type) : _type(type) {}
+
+	// Hash of the node's children and parameters, which determine its result's polygons.
+	// Computed once per epoch; each call to evaluate() or get_hash() starts a new one.
+	uint64_t get_input_hash(uint32_t epoch);
+	uint64_t get_hash(uint32_t epoch);
+	ga_csg* evaluate(uint32_t epoch);
+
+	Type _type;
+	ga_csg::OP _op;
+	ga_csg* _leaf = nullptr;
+	ga_mat4f _transform;
+	std::shared_ptr<ga_csg_expr> _a;
+	std::shared_ptr<ga_csg_expr> _b;
+
+	std::unique_ptr<ga_csg> _result;
+	uint64_t _result_hash = 0;
+
+	uint64_t _input_hash = 0;
+	uint32_t _input_hash_epoch = 0;
+};
+
+#endif
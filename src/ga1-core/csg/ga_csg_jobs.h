@@ -0,0 +1,106 @@
+#ifndef GA_CSG_JOBS_H
+#define GA_CSG_JOBS_H
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+** Evan Wallace - CSG.js - https://github.com/evanw/csg.js
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "jobs/ga_job.h"
+
+#include <algorithm>
+#include <vector>
+
+/*
+** Upper bound on the jobs ga_csg_run_ranges splits a batch of items into.
+** Each job holds a fiber until the caller's wait returns, so this bounds
+** what one batch takes from the pool.
+*/
+static const int k_csg_max_range_jobs = 64;
+
+/*
+** How many runs ga_csg_run_ranges splits count items into: one, when the
+** job system is not running or there are fewer than two runs' worth of
+** items, and otherwise at most k_csg_max_range_jobs runs of at least
+** min_per_job items.
+*/
+inline int ga_csg_range_count(int count, int min_per_job)
+{
+	if (!ga_job::is_running() || count < 2 * min_per_job) return 1;
+	int per_job = std::max(min_per_job, count / k_csg_max_range_jobs + 1);
+	return (count + per_job - 1) / per_job;
+}
+
+/*
+** Call fn(data, run, first, end) for consecutive runs of the items from 0
+** up to count, numbered from 0 up to ga_csg_range_count(count, min_per_job),
+** so each run can keep its own output. The runs are split across the job
+** system, and this returns once all of them are done; a single run is
+** called on this thread.
+*/
+template<typename data_t>
+void ga_csg_run_ranges(int count, int min_per_job, data_t* data, void (*fn)(data_t* data, int run, int first, int end))
+{
+	int run_count = ga_csg_range_count(count, min_per_job);
+	if (run_count == 1) {
+		fn(data, 0, 0, count);
+		return;
+	}
+
+	struct range_data_t
+	{
+		data_t* _data;
+		int _run;
+		int _first;
+		int _end;
+		void (*_fn)(data_t*, int, int, int);
+	};
+
+	int per_job = std::max(min_per_job, count / k_csg_max_range_jobs + 1);
+	std::vector<range_data_t> range_data(run_count);
+	std::vector<ga_job_decl_t> decls(run_count);
+	for (int i = 0; i < run_count; i++) {
+		range_data[i]._data = data;
+		range_data[i]._run = i;
+		range_data[i]._first = i * per_job;
+		range_data[i]._end = std::min(count, (i + 1) * per_job);
+		range_data[i]._fn = fn;
+		decls[i]._data = &range_data[i];
+		decls[i]._entry = [](void* job_data)
+		{
+			auto range = static_cast<range_data_t*>(job_data);
+			range->_fn(range->_data, range->_run, range->_first, range->_end);
+		};
+	}
+
+	int32_t counter;
+	ga_job::run(decls.data(), run_count, &counter);
+	ga_job::wait(&counter);
+}
+
+/*
+** As above, for runs which write only to their own items and so do not
+** need their index: calls fn(data, first, end).
+*/
+template<typename data_t>
+void ga_csg_run_ranges(int count, int min_per_job, data_t* data, void (*fn)(data_t* data, int first, int end))
+{
+	struct bound_t
+	{
+		data_t* _data;
+		void (*_fn)(data_t*, int, int);
+	};
+
+	bound_t bound = { data, fn };
+	ga_csg_run_ranges<bound_t>(count, min_per_job, &bound, [](bound_t* job_bound, int, int first, int end)
+	{
+		job_bound->_fn(job_bound->_data, first, end);
+	});
+}
+
+#endif
@@ -0,0 +1,766 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+** Evan Wallace - CSG.js - https://github.com/evanw/csg.js
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_csg_mesh.h"
+#include "ga_polygon_merge.h"
+#include "jobs/ga_job.h"
+#include "math/ga_math.h"
+#include "math/ga_vec3f.h"
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#pragma region CONSTRUCTORS
+ga_csg_mesh::ga_csg_mesh() {
+    _polygons = std::make_shared<const ga_polygon_soup>();
+    _transform.make_identity();
+}
+
+ga_csg_mesh::ga_csg_mesh(Shape shp) {
+    _polygons = get_template(shp);
+    _transform.make_identity();
+    // Every primitive is convex; the sphere's faces all touch the sphere.
+    _convex = true;
+}
+
+ga_csg_mesh::ga_csg_mesh(const ga_polygon_soup& polys) {
+    _polygons = std::make_shared<const ga_polygon_soup>(polys);
+    _transform.make_identity();
+}
+
+ga_csg_mesh::ga_csg_mesh(ga_polygon_soup&& polys) {
+    _polygons = std::make_shared<const ga_polygon_soup>(std::move(polys));
+    _transform.make_identity();
+}
+
+ga_csg_mesh::ga_csg_mesh(const ga_csg_mesh& other) {
+    _polygons = other._polygons;
+    _bsp_options = other._bsp_options;
+    _convex = other._convex;
+    _merge_coplanar = other._merge_coplanar;
+    _polygon_hash = other._polygon_hash;
+    _polygon_hash_valid = other._polygon_hash_valid;
+    _unit_mass_properties = other._unit_mass_properties;
+    _unit_mass_valid = other._unit_mass_valid;
+    _transform.make_identity();
+}
+
+ga_csg_mesh::ga_csg_mesh(ga_csg_mesh&& other) {
+    *this = std::move(other);
+}
+
+ga_csg_mesh& ga_csg_mesh::operator=(ga_csg_mesh&& other) {
+    if (this == &other) return *this;
+    _transform = other._transform;
+    _polygons = std::move(other._polygons);
+    _bsp_options = other._bsp_options;
+    _convex = other._convex;
+    _merge_coplanar = other._merge_coplanar;
+    _bsp_arena = std::move(other._bsp_arena);
+    _bsp = std::move(other._bsp);
+    _bsp_valid = other._bsp_valid;
+    _polygon_hash = other._polygon_hash;
+    _polygon_hash_valid = other._polygon_hash_valid;
+    _unit_mass_properties = other._unit_mass_properties;
+    _unit_mass_valid = other._unit_mass_valid;
+    _mass_properties = other._mass_properties;
+    _mass_version = other._mass_version;
+    _transform_version = other._transform_version;
+    _world_version = other._world_version;
+    _world_polygons = std::move(other._world_polygons);
+
+    other._polygons = std::make_shared<const ga_polygon_soup>();
+    other._bsp_valid = false;
+    other.polygons_changed();
+    return *this;
+}
+
+// Primitives are built once, on first use, and shared by every mesh of that shape.
+const std::shared_ptr<const ga_polygon_soup>& ga_csg_mesh::get_template(Shape shp) {
+    static const std::shared_ptr<const ga_polygon_soup> cube = std::make_shared<const ga_polygon_soup>(cube_polygons());
+    static const std::shared_ptr<const ga_polygon_soup> sphere = std::make_shared<const ga_polygon_soup>(sphere_polygons());
+    static const std::shared_ptr<const ga_polygon_soup> pyramid = std::make_shared<const ga_polygon_soup>(pyramid_polygons());
+    switch (shp) {
+        case Shape::SPHERE: return sphere;
+        case Shape::PYRAMID: return pyramid;
+        default: return cube;
+    }
+}
+
+#pragma endregion
+
+#pragma region OPERATIONS
+
+// Bounds are grown by this much before testing for overlap, so polygons that
+// only touch the other solid's box still go through the BSP clip.
+static const float k_bounds_padding = 1e-4f;
+
+bool ga_csg_mesh::bounds_overlap(const ga_vec3f& min_a, const ga_vec3f& max_a, const ga_vec3f& min_b, const ga_vec3f& max_b)
+{
+    for (int axis = 0; axis < 3; axis++) {
+        if (min_a.axes[axis] > max_b.axes[axis] + k_bounds_padding) return false;
+        if (max_a.axes[axis] < min_b.axes[axis] - k_bounds_padding) return false;
+    }
+    return true;
+}
+
+// Sort polygons into those whose bounds overlap the box and those entirely
+// outside it. A polygon outside the other solid's box is outside the solid
+// itself, so it can skip the BSP clip.
+static void partition_by_bounds(const ga_polygon_soup& polys, const ga_vec3f& min, const ga_vec3f& max,
+    ga_polygon_soup& inside, ga_polygon_soup& outside)
+{
+    for (int i = 0; i < polys.size(); i++) {
+        ga_vec3f poly_min, poly_max;
+        polys.get_bounds(i, poly_min, poly_max);
+        (ga_csg_mesh::bounds_overlap(poly_min, poly_max, min, max) ? inside : outside).append(polys, i);
+    }
+}
+
+// Merges the fragments an operation leaves of each face, if asked to.
+static ga_polygon_soup finish_polygons(ga_polygon_soup&& polys, bool merge_coplanar)
+{
+    if (!merge_coplanar) return std::move(polys);
+    ga_polygon_soup merged;
+    merge_coplanar_polygons(polys, merged);
+    return merged;
+}
+
+// Supplies an operand's BSP tree.
+typedef std::function<const ga_bsp_flat*()> csg_tree_source_t;
+
+// Builds a tree of polys in the arena and freezes it; the flat tree lives in
+// the arena too, and both go away with it.
+static const ga_bsp_flat* build_flat_bsp(ga_csg_arena& arena, const ga_polygon_soup& polys,
+    const ga_bsp_options& options)
+{
+    return arena.create<ga_bsp_flat>(*arena.create<ga_node>(&arena, polys, options));
+}
+
+// Convex operands with at most this many distinct face planes are clipped
+// one half-space at a time instead of against a BSP tree.
+static const int k_convex_max_planes = 32;
+
+// Clips polygons against one operand. A convex operand with few enough faces
+// is clipped against them directly and never needs a tree; otherwise the
+// tree is asked for at most once, and only when some polygons actually need
+// clipping against it.
+class csg_clipper_t
+{
+public:
+    csg_clipper_t(const ga_polygon_soup& polys, bool convex, csg_tree_source_t tree_source)
+    {
+        _tree_source = std::move(tree_source);
+        _convex = convex && gather_planes(polys, k_convex_max_planes, _planes);
+    }
+
+    void clip(const ga_polygon_soup& polys, bool inverted, ga_polygon_soup& out)
+    {
+        if (_convex) {
+            clip_polygons_to_convex(_planes, polys, inverted, out);
+            return;
+        }
+        if (!_tree) _tree = _tree_source();
+        _tree->clip_polygons(polys, inverted, out);
+    }
+
+private:
+    csg_tree_source_t _tree_source;
+    const ga_bsp_flat* _tree = nullptr;
+    std::vector<ga_csg_plane> _planes;
+    bool _convex;
+};
+
+// Return a new CSG solid representing space in either this solid or in the
+  // solid `csg`. Neither this solid nor the solid `csg` are modified.
+  // 
+  //     A.union(B)
+  // 
+  //     +-------+            +-------+
+  //     |       |            |       |
+  //     |   A   |            |       |
+  //     |    +--+----+   =   |       +----+
+  //     +----+--+    |       +----+       |
+  //          |   B   |            |       |
+  //          |       |            |       |
+  //          +-------+            +-------+
+  // 
+static ga_polygon_soup union_soups(const ga_polygon_soup& a_polys, csg_clipper_t& a,
+    const ga_polygon_soup& b_polys, csg_clipper_t& b)
+{
+    ga_polygon_soup result;
+
+    ga_vec3f a_min, a_max, b_min, b_max;
+    if (!a_polys.get_bounds(a_min, a_max) || !b_polys.get_bounds(b_min, b_max) ||
+        !ga_csg_mesh::bounds_overlap(a_min, a_max, b_min, b_max)) {
+        // Disjoint solids: the union is both surfaces as they are.
+        result = a_polys;
+        result.append(b_polys);
+    }
+    else {
+        ga_polygon_soup a_in, a_out, b_in, b_out;
+        partition_by_bounds(a_polys, b_min, b_max, a_in, a_out);
+        partition_by_bounds(b_polys, a_min, a_max, b_in, b_out);
+
+        result = std::move(a_out);
+        if (!a_in.empty()) {
+            b.clip(a_in, false, result);
+        }
+        result.append(b_out);
+        if (!b_in.empty()) {
+            // Clipping the flipped polygons a second time removes faces of B
+            // that are coplanar with faces of A, so they are only kept once.
+            ga_polygon_soup b_clipped;
+            a.clip(b_in, false, b_clipped);
+            b_clipped.flip();
+            ga_polygon_soup b_kept;
+            a.clip(b_clipped, false, b_kept);
+            b_kept.flip();
+            result.append(b_kept);
+        }
+    }
+
+    return result;
+}
+
+ga_polygon_soup ga_csg_mesh::add_polygons(ga_csg_mesh& other)
+{
+    csg_clipper_t a(get_polygon_soup(), _convex, [this]() { return get_bsp(); });
+    csg_clipper_t b(other.get_polygon_soup(), other._convex, [&other]() { return other.get_bsp(); });
+    return finish_polygons(union_soups(get_polygon_soup(), a, other.get_polygon_soup(), b), _merge_coplanar);
+}
+
+// Return a new CSG solid representing space in this solid but not in the
+ // solid `csg`. Neither this solid nor the solid `csg` are modified.
+ // 
+ //     A.subtract(B)
+ // 
+ //     +-------+            +-------+
+ //     |       |            |       |
+ //     |   A   |            |       |
+ //     |    +--+----+   =   |    +--+
+ //     +----+--+    |       +----+
+ //          |   B   |
+ //          |       |
+ //          +-------+
+ // 
+static ga_polygon_soup subtract_soups(const ga_polygon_soup& a_polys, csg_clipper_t& a,
+    const ga_polygon_soup& b_polys, csg_clipper_t& b)
+{
+    ga_polygon_soup result;
+
+    ga_vec3f a_min, a_max, b_min, b_max;
+    if (!a_polys.get_bounds(a_min, a_max) || !b_polys.get_bounds(b_min, b_max) ||
+        !ga_csg_mesh::bounds_overlap(a_min, a_max, b_min, b_max)) {
+        // Disjoint solids: nothing is cut away.
+        result = a_polys;
+    }
+    else {
+        // Polygons of B outside A's box cannot be part of the result.
+        ga_polygon_soup a_in, a_out, b_in, b_out;
+        partition_by_bounds(a_polys, b_min, b_max, a_in, a_out);
+        partition_by_bounds(b_polys, a_min, a_max, b_in, b_out);
+
+        if (!a_in.empty()) {
+            a_in.flip();
+            b.clip(a_in, false, result);
+            result.flip();
+        }
+        result.append(a_out);
+        if (!b_in.empty()) {
+            ga_polygon_soup b_clipped;
+            a.clip(b_in, true, b_clipped);
+            b_clipped.flip();
+            a.clip(b_clipped, true, result);
+        }
+    }
+
+    return result;
+}
+
+ga_polygon_soup ga_csg_mesh::subtract_polygons(ga_csg_mesh& other)
+{
+    csg_clipper_t a(get_polygon_soup(), _convex, [this]() { return get_bsp(); });
+    csg_clipper_t b(other.get_polygon_soup(), other._convex, [&other]() { return other.get_bsp(); });
+    return finish_polygons(subtract_soups(get_polygon_soup(), a, other.get_polygon_soup(), b), _merge_coplanar);
+}
+
+// Return a new CSG solid representing space both this solid and in the
+// solid `csg`. Neither this solid nor the solid `csg` are modified.
+// 
+//     A.intersect(B)
+// 
+//     +-------+
+//     |       |
+//     |   A   |
+//     |    +--+----+   =   +--+
+//     +----+--+    |       +--+
+//          |   B   |
+//          |       |
+//          +-------+
+// 
+static ga_polygon_soup intersect_soups(const ga_polygon_soup& a_polys, csg_clipper_t& a,
+    const ga_polygon_soup& b_polys, csg_clipper_t& b)
+{
+    ga_polygon_soup result;
+
+    ga_vec3f a_min, a_max, b_min, b_max;
+    if (a_polys.get_bounds(a_min, a_max) && b_polys.get_bounds(b_min, b_max) &&
+        ga_csg_mesh::bounds_overlap(a_min, a_max, b_min, b_max)) {
+        // Only polygons inside the other solid's box can be part of the
+        // result. Disjoint solids have an empty intersection.
+        ga_polygon_soup a_in, a_out, b_in, b_out;
+        partition_by_bounds(a_polys, b_min, b_max, a_in, a_out);
+        partition_by_bounds(b_polys, a_min, a_max, b_in, b_out);
+
+        if (!a_in.empty()) {
+            a_in.flip();
+            b.clip(a_in, true, result);
+            result.flip();
+        }
+        if (!b_in.empty()) {
+            ga_polygon_soup b_clipped;
+            a.clip(b_in, true, b_clipped);
+            b_clipped.flip();
+            ga_polygon_soup b_kept;
+            a.clip(b_clipped, true, b_kept);
+            b_kept.flip();
+            result.append(b_kept);
+        }
+    }
+
+    return result;
+}
+
+ga_polygon_soup ga_csg_mesh::intersect_polygons(ga_csg_mesh& other)
+{
+    csg_clipper_t a(get_polygon_soup(), _convex, [this]() { return get_bsp(); });
+    csg_clipper_t b(other.get_polygon_soup(), other._convex, [&other]() { return other.get_bsp(); });
+    return finish_polygons(intersect_soups(get_polygon_soup(), a, other.get_polygon_soup(), b), _merge_coplanar);
+}
+
+ga_polygon_soup ga_csg_mesh::combine_polygons(OP op, const ga_polygon_soup& a_polys, const ga_polygon_soup& b_polys,
+    const ga_bsp_options& options, bool a_convex, bool b_convex, bool merge_coplanar)
+{
+    ga_csg_arena arena;
+    csg_clipper_t a(a_polys, a_convex, [&]() { return build_flat_bsp(arena, a_polys, options); });
+    csg_clipper_t b(b_polys, b_convex, [&]() { return build_flat_bsp(arena, b_polys, options); });
+    switch (op) {
+        case OP::SUB: return finish_polygons(subtract_soups(a_polys, a, b_polys, b), merge_coplanar);
+        case OP::INTERSECT: return finish_polygons(intersect_soups(a_polys, a, b_polys, b), merge_coplanar);
+        default: return finish_polygons(union_soups(a_polys, a, b_polys, b), merge_coplanar);
+    }
+}
+
+// Pairs of operands combined at once by union_all and intersect_all. Every
+// pair forks up to k_parallel_max_depth levels of jobs while building and
+// clipping its trees, holding as many as 64 fibers, so two pairs take at
+// most half of the 256 fibers the engine starts the job system with.
+static const int k_reduce_max_jobs = 2;
+
+ga_polygon_soup ga_csg_mesh::reduce_polygons(const std::vector<ga_csg_mesh*>& meshes, OP op)
+{
+    // An operand is either one of the meshes, whose cached tree can be used,
+    // or the result of an earlier pair, whose tree is built when needed.
+    // The intersection of convex operands is convex as well.
+    struct operand_t
+    {
+        ga_polygon_soup _polys;
+        ga_csg_mesh* _mesh;
+        bool _convex;
+    };
+    std::vector<operand_t> operands(meshes.size());
+    for (int i = 0; i < meshes.size(); i++) {
+        operands[i]._polys = meshes[i]->get_polygon_soup();
+        operands[i]._mesh = meshes[i];
+        operands[i]._convex = meshes[i]->_convex;
+    }
+    if (operands.empty()) return ga_polygon_soup();
+
+    struct reduce_data_t
+    {
+        operand_t* _a;
+        operand_t* _b;
+        OP _op;
+        const ga_bsp_options* _options;
+        bool _merge_coplanar;
+        ga_polygon_soup _result;
+        bool _convex;
+    };
+
+    // Combine neighbours level by level, so every operand takes part in
+    // about log2(n) operations instead of up to n in a left-deep chain.
+    while (operands.size() > 1) {
+        int pair_count = (int)operands.size() / 2;
+        std::vector<reduce_data_t> reduce_data(pair_count);
+        std::vector<ga_job_decl_t> decls(pair_count);
+        for (int i = 0; i < pair_count; i++) {
+            reduce_data[i]._a = &operands[2 * i];
+            reduce_data[i]._b = &operands[2 * i + 1];
+            reduce_data[i]._op = op;
+            reduce_data[i]._options = &meshes[0]->_bsp_options;
+            reduce_data[i]._merge_coplanar = meshes[0]->_merge_coplanar;
+            decls[i]._data = &reduce_data[i];
+            decls[i]._entry = [](void* data)
+            {
+                auto reduce_data = static_cast<reduce_data_t*>(data);
+                operand_t* a = reduce_data->_a;
+                operand_t* b = reduce_data->_b;
+
+                ga_csg_arena arena;
+                auto tree_source = [&arena, reduce_data](operand_t* operand) -> csg_tree_source_t
+                {
+                    if (operand->_mesh) return [operand]() { return operand->_mesh->get_bsp(); };
+                    return [&arena, operand, reduce_data]() {
+                        return build_flat_bsp(arena, operand->_polys, *reduce_data->_options);
+                    };
+                };
+                csg_clipper_t a_clipper(a->_polys, a->_convex, tree_source(a));
+                csg_clipper_t b_clipper(b->_polys, b->_convex, tree_source(b));
+
+                if (reduce_data->_op == OP::INTERSECT) {
+                    reduce_data->_result = intersect_soups(a->_polys, a_clipper, b->_polys, b_clipper);
+                    reduce_data->_convex = a->_convex && b->_convex;
+                }
+                else {
+                    reduce_data->_result = union_soups(a->_polys, a_clipper, b->_polys, b_clipper);
+                    reduce_data->_convex = false;
+                }
+                // Merging every pair keeps the operands of later levels small.
+                reduce_data->_result = finish_polygons(std::move(reduce_data->_result), reduce_data->_merge_coplanar);
+            };
+        }
+
+        if (ga_job::is_running()) {
+            for (int first = 0; first < pair_count; first += k_reduce_max_jobs) {
+                int32_t counter;
+                ga_job::run(&decls[first], std::min(k_reduce_max_jobs, pair_count - first), &counter);
+                ga_job::wait(&counter);
+            }
+        }
+        else {
+            for (int i = 0; i < pair_count; i++) {
+                decls[i]._entry(decls[i]._data);
+            }
+        }
+
+        std::vector<operand_t> next((operands.size() + 1) / 2);
+        for (int i = 0; i < pair_count; i++) {
+            next[i]._polys = std::move(reduce_data[i]._result);
+            next[i]._mesh = nullptr;
+            next[i]._convex = reduce_data[i]._convex;
+        }
+        if (operands.size() % 2) next.back() = operands.back();
+        operands.swap(next);
+    }
+    return operands[0]._polys;
+}
+
+#pragma endregion
+
+#pragma region SHAPES
+// Creates a unit cube, centered at the origin.
+ga_polygon_soup ga_csg_mesh::cube_polygons() {
+    // what the csg will be made with
+    std::vector<ga_polygon> polys;
+    std::vector<ga_vec3f> vertices = {
+        // Front
+        {-0.5, -0.5,  0.5},
+        { 0.5, -0.5,  0.5},
+        { 0.5,  0.5,  0.5},
+        {-0.5,  0.5,  0.5},
+        // Top
+        {-0.5,  0.5,  0.5},
+        { 0.5,  0.5,  0.5},
+        { 0.5,  0.5, -0.5},
+        {-0.5,  0.5, -0.5},
+        // Back
+        { 0.5, -0.5, -0.5},
+        {-0.5, -0.5, -0.5},
+        {-0.5,  0.5, -0.5},
+        { 0.5,  0.5, -0.5},
+         // Bottom
+        { -0.5, -0.5, -0.5},
+        {  0.5, -0.5, -0.5},
+        {  0.5, -0.5,  0.5},
+        { -0.5, -0.5,  0.5},
+         // Left
+        { -0.5, -0.5, -0.5},
+        { -0.5, -0.5,  0.5},
+        { -0.5,  0.5,  0.5},
+        { -0.5,  0.5, -0.5},
+         // Right
+        {  0.5, -0.5,  0.5},
+        {  0.5, -0.5, -0.5},
+        {  0.5,  0.5, -0.5},
+        {  0.5,  0.5,  0.5},
+    };
+    std::vector<ga_vec3f> norms = {
+        {0, 0, +1}, // Front
+        {0, -1, 0}, // Top
+        {0, 0, -1}, // Back
+        {0, -1, 0}, // Bottom
+        {-1, 0, 0}, // Left
+        {+1, 0, 0}  // Right
+    };
+
+    for (int i = 0; i < vertices.size(); i += 4) {
+        std::vector<ga_csg_vertex> vs;
+        for (int j = 0; j < 4; j++) {
+            vs.push_back(ga_csg_vertex(vertices[i+j], norms[i/4]));
+        }
+        polys.push_back(ga_polygon(vs));
+    }
+
+    return ga_polygon_soup(polys);
+}
+// Creates a unit pyramid, centered at the origin.
+ga_polygon_soup ga_csg_mesh::pyramid_polygons() {
+    // what the csg will be made with
+    std::vector<ga_polygon> polys;
+    std::vector<std::vector<ga_vec3f>> vertgroups = {
+        // Bottom
+        std::vector<ga_vec3f>({
+            { -0.5, -0.5, -0.5},
+            {  0.5, -0.5, -0.5},
+            {  0.5, -0.5,  0.5},
+            { -0.5, -0.5,  0.5}
+        }),
+        // Front
+        std::vector<ga_vec3f>({
+            { 0.0, 0.5, 0.0},
+            { -0.5, -0.5,  0.5},
+            {  0.5, -0.5,  0.5}
+        }),
+        // Back
+        std::vector<ga_vec3f>({
+            { 0.0, 0.5, 0.0},
+            {  0.5, -0.5, -0.5},
+            { -0.5, -0.5, -0.5}
+        }),
+        // Left
+        std::vector<ga_vec3f>({
+            { 0.0, 0.5, 0.0},
+            { -0.5, -0.5, -0.5},
+            { -0.5, -0.5,  0.5}
+        }),
+        // Right
+        std::vector<ga_vec3f>({
+            { 0.0, 0.5, 0.0},
+            {  0.5, -0.5,  0.5},
+            {  0.5, -0.5, -0.5}
+        }),
+    };
+
+    std::vector<ga_vec3f> norms = {
+        {0, -1, 0}, // Bottom
+        {0, 0.89442, +0.4472}, // Front  
+        {0, 0.89442, -0.4472}, // Back        
+        {-0.4472, 0.89442, 0}, // Left     
+        {+0.4472, 0.89442, 0} // Right    
+    };
+
+    for (int i = 0; i < vertgroups.size(); i++) {
+        std::vector<ga_csg_vertex> vs;
+        for (int j = 0; j < vertgroups[i].size(); j++) {
+            vs.push_back(ga_csg_vertex(vertgroups[i][j], norms[i]));
+        }
+        polys.push_back(ga_polygon(vs));
+    }
+
+    return ga_polygon_soup(polys);
+}
+// Creates a unit sphere, centered at the origin.
+ga_polygon_soup ga_csg_mesh::sphere_polygons() {
+    // what the csg will be made with
+    std::vector<ga_polygon> polys;
+    std::vector<ga_csg_vertex> verts;
+    int slices = 16;
+    int stacks = 8;
+
+    auto vertex = [&](float theta, float phi) {
+        theta *= GA_PI * 2;
+        phi *= GA_PI;
+        ga_vec3f dir = {
+           cos(theta) * sin(phi),
+           cos(phi),
+           sin(theta) * sin(phi)
+        };
+        verts.push_back(ga_csg_vertex(dir, dir));
+    };
+
+    for (int i = 0; i < slices; i++) {
+        for (int j = 0; j < stacks; j++) {
+            verts.clear();
+            vertex((float)i / slices, (float)j / stacks);
+            if (j > 0) vertex((float)(i + 1) / slices, (float)j / stacks);
+            if (j < stacks - 1) vertex((float)(i + 1) / slices, (float)(j + 1) / stacks);
+            vertex((float)i / slices, (float)(j + 1) / stacks);
+            polys.push_back(ga_polygon(verts));
+        }
+    }
+  
+
+    return ga_polygon_soup(polys);
+}
+#pragma endregion
+
+void ga_csg_mesh::set_polygons(const ga_polygon_soup& polys)
+{
+    _polygons = std::make_shared<const ga_polygon_soup>(polys);
+    polygons_changed();
+}
+
+void ga_csg_mesh::set_polygons(ga_polygon_soup&& polys)
+{
+    _polygons = std::make_shared<const ga_polygon_soup>(std::move(polys));
+    polygons_changed();
+}
+
+void ga_csg_mesh::polygons_changed()
+{
+    _polygon_hash_valid = false;
+    _unit_mass_valid = false;
+    _convex = false;
+    transform_changed();
+}
+
+uint64_t ga_csg_mesh::get_hash()
+{
+    if (!_polygon_hash_valid) {
+        _polygon_hash = _polygons->get_hash();
+        _polygon_hash_valid = true;
+    }
+    return ga_csg_hash(&_transform, sizeof(_transform), _polygon_hash);
+}
+
+const ga_bsp_flat* ga_csg_mesh::get_bsp()
+{
+    if (!_bsp_valid) {
+        // Only the frozen tree is kept. The node tree is released as soon as
+        // it is frozen, leaving the arena's memory for the next build.
+        if (!_bsp_arena) _bsp_arena.reset(new ga_csg_arena());
+        _bsp.freeze(*_bsp_arena->create<ga_node>(_bsp_arena.get(), get_polygon_soup(), _bsp_options));
+        _bsp_arena->reset();
+        _bsp_valid = true;
+    }
+    return &_bsp;
+}
+
+void ga_csg_mesh::contains_points(const ga_vec3f* points, int count, bool* inside)
+{
+    ga_bsp_contains_points(*get_bsp(), points, count, inside);
+}
+
+bool ga_csg_mesh::contains_point(const ga_vec3f& point)
+{
+    bool inside;
+    contains_points(&point, 1, &inside);
+    return inside;
+}
+
+void ga_csg_mesh::raycast(const ga_csg_ray* rays, int count, ga_csg_ray_hit* hits)
+{
+    ga_bsp_raycast(*get_bsp(), rays, count, hits);
+}
+
+bool ga_csg_mesh::raycast(const ga_csg_ray& ray, ga_csg_ray_hit& hit)
+{
+    raycast(&ray, 1, &hit);
+    return hit._hit;
+}
+
+const ga_csg_mass_properties& ga_csg_mesh::get_mass_properties()
+{
+    if (!_unit_mass_valid) {
+        ga_compute_mass_properties(*_polygons, _unit_mass_properties);
+        _unit_mass_valid = true;
+        _mass_version = 0;
+    }
+    if (_mass_version != _transform_version) {
+        ga_transform_mass_properties(_unit_mass_properties, _transform, _mass_properties);
+        _mass_version = _transform_version;
+    }
+    return _mass_properties;
+}
+
+void ga_csg_mesh::get_inertia_tensor(ga_mat4f& tensor, float mass)
+{
+    const ga_csg_mass_properties& props = get_mass_properties();
+    tensor = props._inertia_tensor;
+    float density = props._volume > 0.0f ? mass / props._volume : 0.0f;
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            tensor.data[i][j] *= density;
+        }
+    }
+}
+
+void ga_csg_mesh::get_convex_hulls(std::vector<ga_convex_hull>& hulls, const ga_convex_decomposition_options& options)
+{
+    ga_vec3f min, max;
+    if (!get_polygon_soup().get_bounds(min, max)) {
+        hulls.clear();
+        return;
+    }
+    ga_decompose_convex(*get_bsp(), min, max, options, hulls);
+}
+
+const ga_polygon_soup& ga_csg_mesh::get_polygon_soup()
+{
+    if (_world_version != _transform_version) {
+        _world_polygons = *_polygons;
+        _world_polygons.transform(_transform);
+        _world_version = _transform_version;
+    }
+    return _world_polygons;
+}
+
+void ga_csg_mesh::transform_changed()
+{
+    ++_transform_version;
+    invalidate_bsp();
+}
+
+void ga_csg_mesh::invalidate_bsp()
+{
+    _bsp.clear();
+    _bsp_valid = false;
+}
+
+void ga_csg_mesh::set_pos(ga_vec3f t)
+{
+    _transform.set_translation(t);
+    transform_changed();
+}
+void ga_csg_mesh::set_scale (ga_vec3f t)
+{
+    transform_changed();
+    _transform.data[0][0] = t.axes[0];
+    _transform.data[1][1] = t.axes[1];
+    _transform.data[2][2] = t.axes[2];
+}
+void ga_csg_mesh::extrude(ga_vec3f dir, float amt) {
+    transform_changed();
+    ga_vec3f s = { 1.0f,1.0f,1.0f };    // keep all the other dimensions intact
+    s += dir.scale_result(amt - 1);
+    ga_vec3f currentLengthInDimension = { abs(dir.x) > 0 ? _transform.data[0][0] : 0.0,
+                                          abs(dir.y) > 0 ? _transform.data[1][1] : 0.0,
+                                          abs(dir.z) > 0 ? _transform.data[2][2] : 0.0 };
+    _transform.data[0][0] *= s.axes[0]; // do this for ALL axes
+    _transform.data[1][1] *= s.axes[1]; // do this for ALL axes
+    _transform.data[2][2] *= s.axes[2]; // do this for ALL axes
+    // Move object by a factor of q(adding to previous pos) 
+    // To maintain a similar position to where it was prior to scaling
+    ga_vec3f q = currentLengthInDimension.scale_result((0.5) * (amt - 1.0));
+    _transform.set_translation(_transform.get_translation() + q);
+}
+
+
@@ -0,0 +1,362 @@
+#ifndef GA_CSG_MESH_H
+#define GA_CSG_MESH_H
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+** Evan Wallace - CSG.js - https://github.com/evanw/csg.js
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_csg_polygon.h"
+#include "ga_polygon_soup.h"
+#include "ga_node.h"
+#include "ga_bsp_query.h"
+#include "ga_mass_properties.h"
+#include "ga_convex_decomposition.h"
+#include "ga_csg_arena.h"
+#include "math/ga_mat4f.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/// <summary>
+/// The geometry of a CSG solid: its polygons, its transform in 3D space, and the
+/// BSP tree used by the Union, Subtract, and Intersect operations.
+/// Makes no OpenGL calls, so meshes can be created, combined and destroyed
+/// headless and from inside worker jobs.
+/// </summary>
+/// <remarks>
+/// The unit-space polygons are immutable and shared copy-on-write: copies of a mesh,
+/// and every mesh made from the same primitive shape, reference one soup until
+/// set_polygons gives them their own.
+/// </remarks>
+class ga_csg_mesh
+{
+public:
+	static enum class Shape { CUBE, SPHERE, PYRAMID };
+	static enum class OP { ADD, SUB, INTERSECT};
+
+	/// <summary>
+	/// Creates an empty mesh with an identity transform
+	/// </summary>
+	ga_csg_mesh();
+	/// <summary>
+	/// Creates a mesh resembling the provided primitive shape, centered at the origin
+	/// The polygons are shared with every other mesh of that shape
+	/// </summary>
+	/// <param name="shp"> The primitive shape to be created </param>
+	ga_csg_mesh(Shape shp);
+	/// <summary>
+	/// Creates a mesh from the specified polygon soup, with an identity transform
+	/// </summary>
+	/// <param name="polys"> A polygon soup as it appears in unit-space </param>
+	ga_csg_mesh(const ga_polygon_soup& polys);
+	ga_csg_mesh(ga_polygon_soup&& polys);
+	/// <summary>
+	/// Creates a mesh sharing the polygons and BSP options of another
+	/// The transform is not copied, and the BSP tree is rebuilt when needed
+	/// </summary>
+	/// <param name="other"> The mesh to be duplicated </param>
+	ga_csg_mesh(const ga_csg_mesh& other);
+	/// <summary>
+	/// Takes the polygons, transform, BSP tree and caches of another mesh,
+	/// leaving it empty
+	/// </summary>
+	/// <param name="other"> The mesh to be moved from </param>
+	ga_csg_mesh(ga_csg_mesh&& other);
+	ga_csg_mesh& operator=(ga_csg_mesh&& other);
+
+	/// <summary>
+	/// Retrieve the mesh's polygons as they appear in unit-space
+	/// </summary>
+	/// <returns> Vector of polygons of the mesh centered at the origin, without transformations or scaling applied </returns>
+	std::vector<ga_polygon> get_polygons_raw() {
+		std::vector<ga_polygon> res;
+		_polygons->get_polygons(res);
+		return res;
+	};
+
+	/// <summary>
+	/// Retrieve the mesh's polygons with transformations
+	/// Memory intensive; prefer get_polygon_soup, which does not convert the polygons.
+	/// </summary>
+	/// <returns> Vector of polygons of the mesh with transformations and scalings applied </returns>
+	std::vector<ga_polygon> get_polygons() {
+		std::vector<ga_polygon> res;
+		get_polygon_soup().get_polygons(res);
+		return res;
+	}
+
+	/// <summary>
+	/// Retrieve the mesh's polygons with transformations, in the flat soup layout
+	/// </summary>
+	/// <remarks>
+	/// The world-space soup is cached, and recomputed in one batched pass only when
+	/// the mesh has been moved, scaled, extruded or given new polygons since it was last read.
+	/// </remarks>
+	/// <returns> Polygon soup of the mesh with transformations and scalings applied, owned by this mesh </returns>
+	const ga_polygon_soup& get_polygon_soup();
+
+	/// <summary>
+	/// Retrieve the mesh's polygons as they appear in unit-space, in the flat soup layout
+	/// </summary>
+	/// <returns> Polygon soup of the mesh centered at the origin, owned by this mesh </returns>
+	const ga_polygon_soup& get_polygon_soup_raw() const { return *_polygons; };
+
+	/// <summary>
+	/// Computes the polygons of this + other, this - other, or the space inside both
+	/// Coplanar polygons are merged unless this mesh was told otherwise with set_merge_coplanar
+	/// </summary>
+	/// <param name="other"> The other mesh to perform the operation with </param>
+	/// <returns> The polygons of the result, with transformations and scalings applied </returns>
+	ga_polygon_soup add_polygons(ga_csg_mesh& other);
+	ga_polygon_soup subtract_polygons(ga_csg_mesh& other);
+	ga_polygon_soup intersect_polygons(ga_csg_mesh& other);
+
+	/// <summary>
+	/// Computes the polygons of a op b from soups alone, building both BSP trees as needed
+	/// Reads nothing but its arguments, so is safe to run in a job while the meshes
+	/// the soups were taken from are edited
+	/// </summary>
+	/// <param name="op"> The operation to perform </param>
+	/// <param name="a_polys"> The polygons performing the operation, as they appear in 3D space </param>
+	/// <param name="b_polys"> The polygons which are the second argument of the operation </param>
+	/// <param name="options"> How to build the trees </param>
+	/// <param name="a_convex"> Whether a_polys bound a convex solid, see is_convex </param>
+	/// <param name="b_convex"> Whether b_polys bound a convex solid </param>
+	/// <param name="merge_coplanar"> Whether to merge the fragments of each face, see set_merge_coplanar </param>
+	/// <returns> The polygons of the result </returns>
+	static ga_polygon_soup combine_polygons(OP op, const ga_polygon_soup& a_polys, const ga_polygon_soup& b_polys,
+		const ga_bsp_options& options, bool a_convex = false, bool b_convex = false, bool merge_coplanar = true);
+
+	/// <summary>
+	/// Whether two bounding boxes overlap, or come close enough to touching that
+	/// polygons inside one must still be clipped against the solid in the other
+	/// </summary>
+	/// <returns> False only if everything in one box is outside the other </returns>
+	static bool bounds_overlap(const ga_vec3f& min_a, const ga_vec3f& max_a, const ga_vec3f& min_b, const ga_vec3f& max_b);
+
+	/// <summary>
+	/// Computes the polygons of the Add or Intersect of any number of meshes
+	/// Operands are combined pairwise in a balanced tree, with independent pairs
+	/// running as parallel jobs when the job system is running
+	/// </summary>
+	/// <param name="meshes"> The meshes to combine; each may appear only once </param>
+	/// <param name="op"> ADD or INTERSECT </param>
+	/// <returns> The polygons of the result, with transformations and scalings applied </returns>
+	static ga_polygon_soup reduce_polygons(const std::vector<ga_csg_mesh*>& meshes, OP op);
+
+	/// <summary>
+	/// Replaces the polygons of the mesh, keeping its transform
+	/// The mesh is no longer known to be convex
+	/// </summary>
+	/// <param name="polys"> The new polygons, as they appear in unit-space </param>
+	void set_polygons(const ga_polygon_soup& polys);
+	void set_polygons(ga_polygon_soup&& polys);
+
+	/// <summary>
+	/// Whether the polygons are known to bound a convex solid
+	/// True for the primitives and for intersections of convex meshes, and reset by set_polygons
+	/// </summary>
+	/// <remarks>
+	/// Operations clip against a convex operand with few faces one face plane at a time,
+	/// without building its BSP tree. This covers most cutters, which are boxes and wedges.
+	/// </remarks>
+	/// <returns> True if the mesh is convex; false if it is not, or is not known to be </returns>
+	bool is_convex() const { return _convex; };
+	/// <summary>
+	/// Declares whether the polygons bound a convex solid
+	/// Operations give wrong results for a mesh wrongly declared convex
+	/// </summary>
+	/// <param name="convex"> True only if the mesh is certainly convex </param>
+	void set_convex(bool convex) { _convex = convex; };
+
+	/// <summary>
+	/// Obtain the shared unit-space polygons, which are replaced rather than modified
+	/// </summary>
+	/// <returns> The soup, which may also be referenced by other meshes </returns>
+	const std::shared_ptr<const ga_polygon_soup>& get_shared_polygons() const { return _polygons; };
+
+	/// <summary>
+	/// Hash of everything that determines the mesh's shape in 3D space:
+	/// its polygons and transform
+	/// </summary>
+	/// <returns> A hash which changes whenever the mesh does </returns>
+	uint64_t get_hash();
+
+	/// <summary>
+	/// Creates the polygons of a primitive unit length cube, sphere or pyramid centered at the origin
+	/// </summary>
+	/// <returns> The polygons of the primitive </returns>
+	static ga_polygon_soup cube_polygons();
+	static ga_polygon_soup sphere_polygons();
+	static ga_polygon_soup pyramid_polygons();
+
+	/// <summary>
+	/// Sets a new position for the mesh
+	/// </summary>
+	/// <param name="t"> A position in 3D space, following the format {x,y,z} </param>
+	void set_pos(ga_vec3f t);
+	/// <summary>
+	/// Sets a new scale for the mesh
+	/// </summary>
+	/// <param name="t"> The new scale of the object, following the format {x,y,z} </param>
+	void set_scale(ga_vec3f t);
+	/// <summary>
+	/// Extrudes an object in the specified direction (dir) an amount (amt)
+	/// </summary>
+	/// <param name="dir">
+	/// The direction, or, "face" to extrude.
+	/// </param>
+	/// <param name="amt">
+	/// A value greater than 0, which resembles how much to extrude by
+	/// 0 < amt < 1 will extrude the object inwards by amt*100 percent
+	/// 1 < amt will extrude the object's face outwards by (1-amt)*100 percent
+	/// </param>
+	/// <remarks>
+	/// For example, calling extrude with the parameters (0,1,0) and (1.2) will make the
+	/// top of the object extend, leaving it unchanged in 3D space.
+	/// Calling extrude with the parameters (0,1,0) and (0.8) will instead make the top of the object
+	/// extrude inwards.
+	/// </remarks>
+	void extrude(ga_vec3f dir, float amt);
+	/// <summary>
+	/// Obtain the transform matrix this object uses to appear in 3D space
+	/// </summary>
+	/// <returns> A 4D matrix of floats representing translation and scale </returns>
+	ga_mat4f get_transform() { return _transform; };
+	/// <summary>
+	/// Sets how the BSP trees built by this mesh's operations choose their splitting planes
+	/// </summary>
+	/// <param name="options"> The split strategy, candidate sample size and scoring weights to use </param>
+	void set_bsp_options(const ga_bsp_options& options) { _bsp_options = options; invalidate_bsp(); };
+	/// <summary>
+	/// Obtain the options used when building BSP trees for this mesh's operations
+	/// </summary>
+	/// <returns> The split strategy, candidate sample size and scoring weights in use </returns>
+	ga_bsp_options get_bsp_options() { return _bsp_options; };
+	/// <summary>
+	/// Sets whether this mesh's operations clean up the polygons they output
+	/// On by default
+	/// </summary>
+	/// <remarks>
+	/// Splitting leaves each face of the result in many fragments, which every later
+	/// operation has to clip in turn. When merging, neighbouring fragments of a face
+	/// are merged into as few convex polygons as possible, T-junctions between them
+	/// are removed, and vertices in the middle of straight edges are dropped.
+	/// </remarks>
+	/// <param name="merge"> True to merge coplanar polygons, false to keep the fragments </param>
+	void set_merge_coplanar(bool merge) { _merge_coplanar = merge; };
+	/// <summary>
+	/// Obtain whether this mesh's operations merge the coplanar polygons they output
+	/// </summary>
+	/// <returns> True if they do </returns>
+	bool get_merge_coplanar() const { return _merge_coplanar; };
+	/// <summary>
+	/// Obtain the BSP tree of this mesh's polygons as they appear in 3D space
+	/// The tree is built on first use and kept until the mesh is moved, scaled or extruded
+	/// </summary>
+	/// <remarks>
+	/// Operations read the tree directly, clipping against it in either orientation,
+	/// so combining one solid with many others only builds its tree once.
+	/// The tree is kept frozen into flat arrays, which is all clipping needs.
+	/// Not safe to call on the same mesh from several threads at once.
+	/// </remarks>
+	/// <returns> The cached tree, owned by this mesh </returns>
+	const ga_bsp_flat* get_bsp();
+	/// <summary>
+	/// Finds which of a batch of points, in 3D space, are inside this solid
+	/// The points walk this mesh's BSP tree several at a time, and large batches are split across jobs
+	/// </summary>
+	/// <param name="points"> The points to test </param>
+	/// <param name="count"> The number of points </param>
+	/// <param name="inside"> Set to true for each point inside the solid; points on its surface may go either way </param>
+	void contains_points(const ga_vec3f* points, int count, bool* inside);
+	/// <summary>
+	/// Finds whether a single point, in 3D space, is inside this solid
+	/// </summary>
+	/// <param name="point"> The point to test </param>
+	/// <returns> True if the point is inside </returns>
+	bool contains_point(const ga_vec3f& point);
+	/// <summary>
+	/// Casts a batch of rays, in 3D space, against this solid, finding where each first enters it
+	/// Large batches are split across jobs
+	/// </summary>
+	/// <param name="rays"> The rays to cast </param>
+	/// <param name="count"> The number of rays </param>
+	/// <param name="hits"> Filled with where each ray hits, if it does </param>
+	void raycast(const ga_csg_ray* rays, int count, ga_csg_ray_hit* hits);
+	/// <summary>
+	/// Casts a single ray, in 3D space, against this solid
+	/// </summary>
+	/// <param name="ray"> The ray to cast </param>
+	/// <param name="hit"> Filled with where the ray hits, if it does </param>
+	/// <returns> True if the ray hits the solid </returns>
+	bool raycast(const ga_csg_ray& ray, ga_csg_ray_hit& hit);
+	/// <summary>
+	/// Obtain the volume, centroid and inertia tensor of this solid as it appears in 3D space, at unit density
+	/// </summary>
+	/// <remarks>
+	/// Computed exactly from the closed polygons with the divergence theorem. The properties of
+	/// the unit-space polygons are computed once and kept with them, so moving, scaling or
+	/// extruding the mesh only transforms them, and copies of the mesh never recompute them.
+	/// </remarks>
+	/// <returns> The cached properties, owned by this mesh </returns>
+	const ga_csg_mass_properties& get_mass_properties();
+	/// <summary>
+	/// Fills out the inertia tensor, about the centroid, of a body of this shape and the given mass
+	/// Matches ga_shape::get_inertia_tensor, so CSG results can be given to a rigid body
+	/// </summary>
+	/// <param name="tensor"> Set to the inertia tensor; zero if the solid encloses no volume </param>
+	/// <param name="mass"> The mass of the body </param>
+	void get_inertia_tensor(ga_mat4f& tensor, float mass);
+	/// <summary>
+	/// Splits this solid, as it appears in 3D space, into a small set of convex hulls for collision
+	/// </summary>
+	/// <remarks>
+	/// The hulls start as the solid cells of this mesh's BSP tree. They are merged while they stay
+	/// close to convex, and then until there are no more than the options allow. Testing a few hulls
+	/// with gjk is far cheaper than testing every polygon. The hulls are not cached.
+	/// </remarks>
+	/// <param name="hulls"> Replaced with the hulls, each a set of points in 3D space </param>
+	/// <param name="options"> The most hulls, and vertices per hull, to emit, and how far from convex a hull may be </param>
+	void get_convex_hulls(std::vector<ga_convex_hull>& hulls, const ga_convex_decomposition_options& options = ga_convex_decomposition_options());
+
+protected:
+	ga_mat4f _transform;
+	std::shared_ptr<const ga_polygon_soup> _polygons;
+	ga_bsp_options _bsp_options;
+	bool _convex = false;
+	bool _merge_coplanar = true;
+
+private:
+	void invalidate_bsp();
+	void transform_changed();
+	void polygons_changed();
+	static const std::shared_ptr<const ga_polygon_soup>& get_template(Shape shp);
+
+	// Kept around so each new tree is built in the last one's memory.
+	std::unique_ptr<ga_csg_arena> _bsp_arena;
+	ga_bsp_flat _bsp;
+	bool _bsp_valid = false;
+	uint64_t _polygon_hash = 0;
+	bool _polygon_hash_valid = false;
+	ga_csg_mass_properties _unit_mass_properties;
+	bool _unit_mass_valid = false;
+	// The unit-space properties transformed into 3D space; current while
+	// _mass_version matches _transform_version.
+	ga_csg_mass_properties _mass_properties;
+	uint32_t _mass_version = 0;
+	// Bumped whenever _transform or _polygons change; _world_polygons is current
+	// while _world_version matches it.
+	uint32_t _transform_version = 1;
+	uint32_t _world_version = 0;
+	ga_polygon_soup _world_polygons;
+};
+
+#endif
@@ -0,0 +1,92 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+** Evan Wallace - CSG.js - https://github.com/evanw/csg.js
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_csg_mesh_builder.h"
+
+#include <cstring>
+
+static const uint32_t k_empty_slot = 0xffffffff;
+
+// Vertices share an index only if every bit of the position and normal match.
+static inline uint32_t hash_vertex(const ga_vec3f& pos, const ga_vec3f& normal)
+{
+	uint32_t bits[6];
+	memcpy(bits, &pos, sizeof(ga_vec3f));
+	memcpy(bits + 3, &normal, sizeof(ga_vec3f));
+	uint32_t hash = 2166136261u;
+	for (int i = 0; i < 6; i++) {
+		hash = (hash ^ bits[i]) * 16777619u;
+		hash ^= hash >> 15;
+	}
+	return hash;
+}
+
+void ga_csg_mesh_builder::build(const ga_polygon_soup& polys)
+{
+	int vertex_count = polys.get_vertex_count();
+
+	_positions.clear();
+	_normals.clear();
+	_indices.clear();
+	_indices16.clear();
+	_positions.reserve(vertex_count);
+	_normals.reserve(vertex_count);
+	_indices.reserve(3 * (vertex_count - 2 * polys.size()));
+
+	// Keep the table at most half full.
+	uint32_t table_size = 16;
+	while (table_size < 2 * (uint32_t)vertex_count) table_size *= 2;
+	_table.assign(table_size, k_empty_slot);
+	_table_mask = table_size - 1;
+
+	for (int i = 0; i < polys.size(); i++) {
+		const ga_vec3f* positions = polys.get_positions(i);
+		const ga_vec3f* normals = polys.get_normals(i);
+		int count = polys.get_count(i);
+
+		uint32_t first = weld(positions[0], normals[0]);
+		uint32_t previous = weld(positions[1], normals[1]);
+		for (int j = 2; j < count; j++) {
+			uint32_t current = weld(positions[j], normals[j]);
+			_indices.push_back(first);
+			_indices.push_back(previous);
+			_indices.push_back(current);
+			previous = current;
+		}
+	}
+
+	_wide = _positions.size() > 0x10000;
+	if (!_wide) {
+		_indices16.resize(_indices.size());
+		for (size_t i = 0; i < _indices.size(); i++) {
+			_indices16[i] = (uint16_t)_indices[i];
+		}
+	}
+}
+
+uint32_t ga_csg_mesh_builder::weld(const ga_vec3f& pos, const ga_vec3f& normal)
+{
+	uint32_t slot = hash_vertex(pos, normal) & _table_mask;
+	for (;;) {
+		uint32_t index = _table[slot];
+		if (index == k_empty_slot) {
+			index = (uint32_t)_positions.size();
+			_positions.push_back(pos);
+			_normals.push_back(normal);
+			_table[slot] = index;
+			return index;
+		}
+		if (memcmp(&_positions[index], &pos, sizeof(ga_vec3f)) == 0 &&
+			memcmp(&_normals[index], &normal, sizeof(ga_vec3f)) == 0) {
+			return index;
+		}
+		slot = (slot + 1) & _table_mask;
+	}
+}
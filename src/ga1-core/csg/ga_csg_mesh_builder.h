@@ -0,0 +1,61 @@
+#ifndef GA_CSG_MESH_BUILDER_H
+#define GA_CSG_MESH_BUILDER_H
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+** Evan Wallace - CSG.js - https://github.com/evanw/csg.js
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "math/ga_vec3f.h"
+#include "ga_polygon_soup.h"
+
+#include <cstdint>
+#include <vector>
+
+/*
+** Turns a polygon soup into an indexed triangle mesh ready for upload.
+**
+** Every convex polygon, whatever its vertex count, becomes a triangle fan
+** around its first vertex. Vertices with the same position and normal are
+** welded through a hash table, so each is stored once. Indices are 16-bit
+** while the mesh has at most 65536 vertices and 32-bit past that.
+**
+** Building is a single linear pass over the soup. A builder can be reused;
+** its buffers keep their capacity between builds.
+*/
+class ga_csg_mesh_builder
+{
+public:
+	void build(const ga_polygon_soup& polys);
+
+	const std::vector<ga_vec3f>& get_positions() const { return _positions; }
+	const std::vector<ga_vec3f>& get_normals() const { return _normals; }
+
+	int get_index_count() const { return (int)_indices.size(); }
+
+	/*
+	** Size in bytes of one index, 2 or 4, and the index data in that format.
+	*/
+	int get_index_size() const { return _wide ? 4 : 2; }
+	const void* get_index_data() const { return _wide ? (const void*)_indices.data() : (const void*)_indices16.data(); }
+
+private:
+	uint32_t weld(const ga_vec3f& pos, const ga_vec3f& normal);
+
+	std::vector<ga_vec3f> _positions;
+	std::vector<ga_vec3f> _normals;
+	std::vector<uint32_t> _indices;
+	std::vector<uint16_t> _indices16;
+	bool _wide = false;
+
+	// Open addressing table of vertex indices, empty slots are UINT32_MAX.
+	std::vector<uint32_t> _table;
+	uint32_t _table_mask = 0;
+};
+
+#endif
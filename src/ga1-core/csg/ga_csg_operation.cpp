@@ -0,0 +1,247 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+** Evan Wallace - CSG.js - https://github.com/evanw/csg.js
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_csg_operation.h"
+#include "ga_polygon_merge.h"
+
+#include <algorithm>
+#include <utility>
+
+// Polygons sorted by their bounds in each partition step.
+static const int k_partition_step_polygons = 256;
+
+ga_csg_operation::ga_csg_operation(ga_csg& a, ga_csg& b, ga_csg::OP op, Mode mode)
+{
+	_op = op;
+	_mode = mode;
+	_a_polys = a.get_polygon_soup();
+	_b_polys = b.get_polygon_soup();
+	_options = a.get_bsp_options();
+	_a_convex = a.is_convex();
+	_b_convex = b.is_convex();
+	_merge_coplanar = a.get_merge_coplanar();
+	_color = ga_vec3f_lerp(a.get_color(), b.get_color(), 0.5);
+	_name = "Poly";
+
+	if (_mode == Mode::TIME_SLICED) {
+		_program = &get_program(op);
+		return;
+	}
+
+	_decl._data = this;
+	_decl._entry = [](void* data)
+	{
+		auto operation = static_cast<ga_csg_operation*>(data);
+		operation->_result_polys = ga_csg_mesh::combine_polygons(operation->_op,
+			operation->_a_polys, operation->_b_polys, operation->_options,
+			operation->_a_convex, operation->_b_convex, operation->_merge_coplanar);
+		// The operands are no longer needed; free them from the job.
+		operation->_a_polys = ga_polygon_soup();
+		operation->_b_polys = ga_polygon_soup();
+	};
+}
+
+ga_csg_operation::~ga_csg_operation()
+{
+	if (_started && ga_job::is_running()) {
+		ga_job::wait(&_counter);
+	}
+}
+
+void ga_csg_operation::start()
+{
+	_started = true;
+	if (ga_job::is_running()) {
+		ga_job::run(&_decl, 1, &_counter);
+	}
+	else {
+		_decl._entry(_decl._data);
+	}
+}
+
+bool ga_csg_operation::is_computed() const
+{
+	if (_mode == Mode::TIME_SLICED) return _stage == int(_program->size());
+	return _started && ga_job::is_done(&_counter);
+}
+
+float ga_csg_operation::get_progress() const
+{
+	if (is_computed()) return 1.0f;
+	if (_mode == Mode::JOB) return 0.0f;
+	float stage = float(_stage) + (_substep > 0 ? 0.5f : 0.0f);
+	return stage / float(_program->size());
+}
+
+ga_csg* ga_csg_operation::create_result()
+{
+	_result = new ga_csg(std::move(_result_polys));
+	_result->set_color(_color);
+	_result->set_convex(_op == ga_csg::OP::INTERSECT && _a_convex && _b_convex);
+	_result->name = _name;
+	return _result;
+}
+
+// The same sequences of clips and flips as ga_csg_mesh::combine_polygons,
+// written out as stages. Soups with nothing in them pass through every
+// stage at no cost, and a tree is only built once something is clipped by it.
+const std::vector<ga_csg_operation::stage_t>& ga_csg_operation::get_program(ga_csg::OP op)
+{
+	typedef stage_kind_t k;
+	static const std::vector<stage_t> add_program = {
+		{ k::PARTITION, 0, RESULT, RESULT, false },
+		{ k::APPEND, 0, A_OUT, RESULT, false },
+		{ k::CLIP, 1, A_IN, RESULT, false },
+		{ k::APPEND, 0, B_OUT, RESULT, false },
+		// Clipping the flipped polygons a second time removes faces of B
+		// that are coplanar with faces of A, so they are only kept once.
+		{ k::CLIP, 0, B_IN, CLIPPED, false },
+		{ k::FLIP, 0, CLIPPED, CLIPPED, false },
+		{ k::CLIP, 0, CLIPPED, KEPT, false },
+		{ k::FLIP, 0, KEPT, KEPT, false },
+		{ k::APPEND, 0, KEPT, RESULT, false },
+		{ k::MERGE, 0, RESULT, RESULT, false },
+	};
+	static const std::vector<stage_t> subtract_program = {
+		{ k::PARTITION, 0, RESULT, RESULT, false },
+		{ k::FLIP, 0, A_IN, A_IN, false },
+		{ k::CLIP, 1, A_IN, RESULT, false },
+		{ k::FLIP, 0, RESULT, RESULT, false },
+		{ k::APPEND, 0, A_OUT, RESULT, false },
+		{ k::CLIP, 0, B_IN, CLIPPED, true },
+		{ k::FLIP, 0, CLIPPED, CLIPPED, false },
+		{ k::CLIP, 0, CLIPPED, RESULT, true },
+		{ k::MERGE, 0, RESULT, RESULT, false },
+	};
+	static const std::vector<stage_t> intersect_program = {
+		{ k::PARTITION, 0, RESULT, RESULT, false },
+		{ k::FLIP, 0, A_IN, A_IN, false },
+		{ k::CLIP, 1, A_IN, RESULT, true },
+		{ k::FLIP, 0, RESULT, RESULT, false },
+		{ k::CLIP, 0, B_IN, CLIPPED, true },
+		{ k::FLIP, 0, CLIPPED, CLIPPED, false },
+		{ k::CLIP, 0, CLIPPED, KEPT, true },
+		{ k::FLIP, 0, KEPT, KEPT, false },
+		{ k::APPEND, 0, KEPT, RESULT, false },
+		{ k::MERGE, 0, RESULT, RESULT, false },
+	};
+	switch (op) {
+		case ga_csg::OP::SUB: return subtract_program;
+		case ga_csg::OP::INTERSECT: return intersect_program;
+		default: return add_program;
+	}
+}
+
+bool ga_csg_operation::advance(std::chrono::steady_clock::time_point deadline)
+{
+	while (!is_computed() && !_cancelled && std::chrono::steady_clock::now() < deadline) {
+		step();
+	}
+	return is_computed();
+}
+
+void ga_csg_operation::step()
+{
+	const stage_t& stage = (*_program)[_stage];
+	switch (stage._kind) {
+		case stage_kind_t::PARTITION:
+			if (_substep == 0) {
+				_substep = 1;
+				_overlap = _a_polys.get_bounds(_a_min, _a_max) && _b_polys.get_bounds(_b_min, _b_max) &&
+					ga_csg_mesh::bounds_overlap(_a_min, _a_max, _b_min, _b_max);
+				if (!_overlap) {
+					// Disjoint solids: nothing needs clipping, so no trees are built.
+					_soups[A_OUT] = std::move(_a_polys);
+					_soups[B_OUT] = std::move(_b_polys);
+					break;
+				}
+			}
+			else {
+				// Polygons outside the other solid's box are outside the solid
+				// itself, so they can skip the BSP clip.
+				int a_count = _a_polys.size();
+				int end = std::min(_partition_next + k_partition_step_polygons, a_count + _b_polys.size());
+				for (; _partition_next < end; _partition_next++) {
+					bool is_a = _partition_next < a_count;
+					const ga_polygon_soup& polys = is_a ? _a_polys : _b_polys;
+					int poly = is_a ? _partition_next : _partition_next - a_count;
+					ga_vec3f poly_min, poly_max;
+					polys.get_bounds(poly, poly_min, poly_max);
+					bool inside = is_a ?
+						ga_csg_mesh::bounds_overlap(poly_min, poly_max, _b_min, _b_max) :
+						ga_csg_mesh::bounds_overlap(poly_min, poly_max, _a_min, _a_max);
+					_soups[is_a ? (inside ? A_IN : A_OUT) : (inside ? B_IN : B_OUT)].append(polys, poly);
+				}
+				if (_partition_next == a_count + _b_polys.size()) break;
+			}
+			return;
+
+		case stage_kind_t::CLIP:
+			if (_substep == 0) {
+				if (_soups[stage._src].empty()) break;
+				if (!_trees[stage._tree]) {
+					// Partitioning is done, so the operand's polygons are only needed for its tree.
+					_trees[stage._tree] = _arena.create<ga_node>(&_arena);
+					_build.start(_trees[stage._tree], std::move(stage._tree == 0 ? _a_polys : _b_polys), _options);
+				}
+				_substep = 1;
+			}
+			else if (_substep == 1) {
+				if (_build.is_done() || _build.step()) _substep = 2;
+			}
+			else if (_substep == 2) {
+				// Freezing walks the whole tree, so it gets a step of its own. A tree
+				// without planes freezes to an empty one, which costs nothing to redo.
+				ga_bsp_flat& tree = _flat_trees[stage._tree];
+				if (tree.empty()) tree.freeze(*_trees[stage._tree]);
+				_clip.start(&tree, std::move(_soups[stage._src]), stage._inverted, &_soups[stage._dst]);
+				_substep = 3;
+			}
+			else if (_clip.step()) {
+				break;
+			}
+			return;
+
+		case stage_kind_t::FLIP:
+			_soups[stage._dst].flip();
+			break;
+
+		case stage_kind_t::APPEND:
+			if (_soups[stage._dst].empty()) {
+				_soups[stage._dst] = std::move(_soups[stage._src]);
+			}
+			else {
+				_soups[stage._dst].append(_soups[stage._src]);
+			}
+			_soups[stage._src] = ga_polygon_soup();
+			break;
+
+		case stage_kind_t::MERGE:
+			if (_merge_coplanar) {
+				ga_polygon_soup merged;
+				merge_coplanar_polygons(_soups[stage._dst], merged);
+				_soups[stage._dst] = std::move(merged);
+			}
+			break;
+	}
+
+	_stage++;
+	_substep = 0;
+	if (is_computed()) {
+		_result_polys = std::move(_soups[RESULT]);
+		for (int i = 0; i < SOUP_COUNT; i++) _soups[i] = ga_polygon_soup();
+		_a_polys = ga_polygon_soup();
+		_b_polys = ga_polygon_soup();
+		_trees[0] = _trees[1] = nullptr;
+		_flat_trees[0].clear();
+		_flat_trees[1].clear();
+		_arena.reset();
+	}
+}
@@ -0,0 +1,177 @@
+#ifndef GA_CSG_OPERATION_H
+#define GA_CSG_OPERATION_H
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+** Evan Wallace - CSG.js - https://github.com/evanw/csg.js
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_csg.h"
+#include "jobs/ga_job.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// A handle to an Add, Subtract or Intersect running in the background,
+/// returned by ga_csg_component::submit.
+/// </summary>
+/// <remarks>
+/// The operands are copied as they appear in 3D space when the operation is submitted,
+/// so they may be moved, edited or removed while it runs.
+/// The polygons are computed in a job, or, in TIME_SLICED mode, a few milliseconds at
+/// a time by ga_csg_component::update; the result csg, and its vertex arrays, are only
+/// created by ga_csg_component::finish_operations on the main thread.
+/// Only a few jobs of a component run at once; the rest wait in its queue until
+/// finish_operations sees a running one finish.
+/// </remarks>
+class ga_csg_operation
+{
+public:
+	/// <summary>
+	/// JOB runs the whole operation as one job, which may fork more while building and clipping.
+	/// TIME_SLICED runs it on the thread that updates its component, as a state machine
+	/// which stops between steps once the component's time budget for the frame is spent,
+	/// so heavy operations need no background threads and cause no frame spikes.
+	/// </summary>
+	enum class Mode { JOB, TIME_SLICED };
+
+	/// <summary>
+	/// Copies the operands of a op b
+	/// Nothing is computed until the component holding the operation starts its job,
+	/// in JOB mode, or advances it, in TIME_SLICED mode
+	/// </summary>
+	/// <param name="a"> The csg performing the operation </param>
+	/// <param name="b"> The csg which is the second argument of the operation </param>
+	/// <param name="op"> The operation to perform </param>
+	/// <param name="mode"> How the operation is run </param>
+	ga_csg_operation(ga_csg& a, ga_csg& b, ga_csg::OP op, Mode mode = Mode::JOB);
+	/// <summary>
+	/// Waits for the job, if it has been started and is still running
+	/// </summary>
+	~ga_csg_operation();
+
+	/// <summary>
+	/// Obtain how the operation is run
+	/// </summary>
+	/// <returns> JOB or TIME_SLICED </returns>
+	Mode get_mode() const { return _mode; };
+	/// <summary>
+	/// Obtain how far the operation has come
+	/// A job only reports 0 or 1, and 0 while it waits to be started; a time-sliced
+	/// operation reports the fraction of its stages finished, counting a stage part
+	/// done once it has started
+	/// </summary>
+	/// <returns> A value from 0 to 1, which is 1 once the polygons are computed </returns>
+	float get_progress() const;
+	/// <summary>
+	/// Cancels the operation, so no result is ever created
+	/// A time-sliced operation stops before its next step, and a job that has not
+	/// started never does; a running job cannot be interrupted, so runs to the end
+	/// and has its polygons discarded
+	/// </summary>
+	void cancel() { _cancelled = true; };
+	/// <summary>
+	/// Whether cancel has been called
+	/// </summary>
+	/// <returns> True if the operation was cancelled </returns>
+	bool is_cancelled() const { return _cancelled; };
+
+	/// <summary>
+	/// Whether the result has been created and added to its component
+	/// </summary>
+	/// <returns> True once get_result returns the result </returns>
+	bool is_done() const { return _result != nullptr; };
+	/// <summary>
+	/// Obtain the result of the operation
+	/// </summary>
+	/// <returns> The result, owned by the component it was added to, or null while the operation runs </returns>
+	ga_csg* get_result() { return _result; };
+	/// <summary>
+	/// Sets the name given to the result once it is created
+	/// </summary>
+	/// <param name="name"> The name of the result </param>
+	void set_name(const std::string& name) { _name = name; };
+
+private:
+	friend class ga_csg_component;
+
+	// Starts computing a JOB operation: as a job if the job system is running,
+	// and otherwise at once.
+	void start();
+	// Whether a JOB operation has been started.
+	bool is_started() const { return _started; };
+	// Whether the polygons of the result have been computed.
+	bool is_computed() const;
+	// Creates the result from the computed polygons; called on the main thread.
+	ga_csg* create_result();
+	// Runs steps of a time-sliced operation until it is computed, cancelled, or
+	// the deadline has passed. Every step is bounded, so the deadline is only
+	// ever overrun by one step. Returns true once the polygons are computed.
+	bool advance(std::chrono::steady_clock::time_point deadline);
+	// Does one bounded step of a time-sliced operation.
+	void step();
+
+	// The soups a time-sliced operation works on. The A_IN and B_IN polygons
+	// overlap the other solid's box and must be clipped; the rest are outside it.
+	enum soup_t { A_IN, A_OUT, B_IN, B_OUT, CLIPPED, KEPT, RESULT, SOUP_COUNT };
+	enum class stage_kind_t { PARTITION, CLIP, FLIP, APPEND, MERGE };
+	// One stage of the program run by a time-sliced operation. CLIP clips _src
+	// against the tree of operand _tree, building and freezing it first if
+	// needed, and appends what is kept to _dst; FLIP flips _dst; APPEND moves
+	// _src onto the end of _dst; MERGE merges the coplanar polygons of _dst,
+	// if the operation does so, in a single step.
+	struct stage_t
+	{
+		stage_kind_t _kind;
+		int _tree;
+		soup_t _src;
+		soup_t _dst;
+		bool _inverted;
+	};
+	static const std::vector<stage_t>& get_program(ga_csg::OP op);
+
+	ga_csg::OP _op;
+	Mode _mode;
+	ga_polygon_soup _a_polys;
+	ga_polygon_soup _b_polys;
+	ga_bsp_options _options;
+	bool _a_convex;
+	bool _b_convex;
+	bool _merge_coplanar;
+	ga_polygon_soup _result_polys;
+	ga_vec3f _color;
+	std::string _name;
+
+	ga_job_decl_t _decl;
+	int32_t _counter = 0;
+	bool _started = false;
+	ga_csg* _result = nullptr;
+	std::atomic<bool> _cancelled{ false };
+
+	// State of a time-sliced operation, kept between steps.
+	const std::vector<stage_t>* _program = nullptr;
+	int _stage = 0;
+	// 0 before the stage has started; for CLIP, 1 while building, 2 to freeze
+	// the tree and 3 while clipping.
+	int _substep = 0;
+	int _partition_next = 0;
+	ga_vec3f _a_min, _a_max, _b_min, _b_max;
+	bool _overlap = false;
+	ga_polygon_soup _soups[SOUP_COUNT];
+	ga_csg_arena _arena;
+	ga_node* _trees[2] = { nullptr, nullptr };
+	ga_bsp_flat _flat_trees[2];
+	ga_node_build_task _build;
+	ga_node_clip_task _clip;
+};
+
+#endif
@@ -16,7 +16,6 @@
 #include "math/ga_mat4f.h"
 #include "ga_plane.h"
 #include "ga_csg_vertex.h"
-#include <GL/glew.h>
 
 #include <string>
 #include <vector>
@@ -29,30 +28,19 @@ class ga_polygon
 public:
 	ga_polygon();
 	ga_polygon(std::vector<ga_csg_vertex>& verts);
-	ga_polygon(std::vector<ga_csg_vertex>& verts, std::vector<ga_vec3f>& shared);
 	ga_polygon(const ga_polygon& other);
+	ga_polygon(ga_polygon&& other);
+	ga_polygon& operator=(const ga_polygon& other);
+	ga_polygon& operator=(ga_polygon&& other);
 	void flip();
 	ga_polygon flipped();
 	~ga_polygon();
 
-	void get_vbo_info(ga_mat4f& transform, 
-					  std::vector<ga_vec3f>& verts,
-					  std::vector<ga_vec3f>& normals,
-					  std::vector<GLushort>& indices);
-
 	bool isTri() { return _vertices.size() == 3; };
 	bool isQuad() { return _vertices.size() == 4; };
 
 	std::vector<ga_csg_vertex> _vertices;
-	std::vector<ga_vec3f> _shared; //TODO: What structure is this a std::vector of...
 	ga_csg_plane _plane;
 };
 
-void split_polygon(ga_csg_plane& plane,
-					ga_polygon& polygon,
-					std::vector<ga_polygon>& coplanar_front,
-					std::vector<ga_polygon>& coplanar_back,
-					std::vector<ga_polygon>& front,
-					std::vector<ga_polygon>& back);
-
 #endif
\ No newline at end of file
@@ -0,0 +1,86 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+** Evan Wallace - CSG.js - https://github.com/evanw/csg.js
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_csg_render_proxy.h"
+#include "ga_csg_mesh_builder.h"
+
+#include <map>
+
+// Uploaded meshes by the soup they were built from. Only touched where
+// OpenGL is available, so on one thread.
+static std::map<const ga_polygon_soup*, std::weak_ptr<ga_csg_gpu_mesh>> s_gpu_meshes;
+
+ga_csg_gpu_mesh::~ga_csg_gpu_mesh()
+{
+	glDeleteVertexArrays(1, (GLuint*)&_vao);
+	glDeleteBuffers(3, _vbos);
+}
+
+static std::shared_ptr<ga_csg_gpu_mesh> create_gpu_mesh(const std::shared_ptr<const ga_polygon_soup>& polys)
+{
+	// Positions stay in unit-space; the material applies the csg's transform when drawing.
+	ga_csg_mesh_builder builder;
+	builder.build(*polys);
+	const std::vector<ga_vec3f>& verts = builder.get_positions();
+	const std::vector<ga_vec3f>& normals = builder.get_normals();
+
+	std::shared_ptr<ga_csg_gpu_mesh> mesh = std::make_shared<ga_csg_gpu_mesh>();
+	glGenVertexArrays(1, &mesh->_vao);
+	glBindVertexArray(mesh->_vao);
+	glGenBuffers(3, mesh->_vbos);
+
+	glBindBuffer(GL_ARRAY_BUFFER, mesh->_vbos[0]);
+	glBufferData(GL_ARRAY_BUFFER, verts.size() * 3 * sizeof(float), verts.data(), GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	glEnableVertexAttribArray(0);
+
+	glBindBuffer(GL_ARRAY_BUFFER, mesh->_vbos[1]);
+	glBufferData(GL_ARRAY_BUFFER, normals.size() * 3 * sizeof(float), normals.data(), GL_STATIC_DRAW);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	glEnableVertexAttribArray(1);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->_vbos[2]);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, builder.get_index_size() * builder.get_index_count(), builder.get_index_data(), GL_STATIC_DRAW);
+
+	glBindVertexArray(0);
+
+	mesh->_index_count = builder.get_index_count();
+	mesh->_index_type = (builder.get_index_size() == 4) ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+	mesh->_source = polys;
+	return mesh;
+}
+
+ga_csg_render_proxy::ga_csg_render_proxy()
+{
+	_material = new ga_csg_material();
+	_material->init();
+}
+
+ga_csg_render_proxy::~ga_csg_render_proxy()
+{
+	delete _material;
+}
+
+void ga_csg_render_proxy::upload(const std::shared_ptr<const ga_polygon_soup>& polys)
+{
+	std::weak_ptr<ga_csg_gpu_mesh>& cached = s_gpu_meshes[polys.get()];
+	std::shared_ptr<ga_csg_gpu_mesh> mesh = cached.lock();
+	if (!mesh) {
+		mesh = create_gpu_mesh(polys);
+		cached = mesh;
+	}
+	_mesh = mesh;
+
+	// Drop entries whose meshes are gone, so the cache does not grow with every edit.
+	for (auto it = s_gpu_meshes.begin(); it != s_gpu_meshes.end();) {
+		if (it->second.expired()) it = s_gpu_meshes.erase(it);
+		else ++it;
+	}
+}
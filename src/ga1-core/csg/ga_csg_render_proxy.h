@@ -0,0 +1,73 @@
+#ifndef GA_CSG_RENDER_PROXY_H
+#define GA_CSG_RENDER_PROXY_H
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+** Evan Wallace - CSG.js - https://github.com/evanw/csg.js
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_polygon_soup.h"
+#include "graphics/ga_material.h"
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <memory>
+
+/*
+** The vertex array and buffers of one polygon soup. Shared by every proxy
+** drawing that soup, so csgs sharing primitive polygons share them on the GPU too.
+*/
+struct ga_csg_gpu_mesh
+{
+	~ga_csg_gpu_mesh();
+
+	uint32_t _vao = 0;
+	uint32_t _vbos[3] = { 0, 0, 0 };
+	GLsizei _index_count = 0;
+	GLenum _index_type = GL_UNSIGNED_SHORT;
+	// Held so the soup's address can not be reused while it keys the cache.
+	std::shared_ptr<const ga_polygon_soup> _source;
+};
+
+/// <summary>
+/// The OpenGL resources used to draw a csg: its vertex array, buffers and material.
+/// Created only for csgs which are displayed, and only where OpenGL is available.
+/// </summary>
+class ga_csg_render_proxy
+{
+public:
+	/// <summary>
+	/// Creates the material; the vertex array is created by the first upload
+	/// </summary>
+	ga_csg_render_proxy();
+	~ga_csg_render_proxy();
+
+	/// <summary>
+	/// Draws the given polygons from now on, building an indexed mesh of them
+	/// unless another proxy already uploaded the same soup
+	/// </summary>
+	/// <param name="polys"> The polygons to draw, as they appear in unit-space </param>
+	void upload(const std::shared_ptr<const ga_polygon_soup>& polys);
+
+	/// <summary>
+	/// The soup last uploaded, used to skip uploads of unchanged geometry
+	/// </summary>
+	/// <returns> The soup passed to the last upload, or null </returns>
+	const ga_polygon_soup* get_source() const { return _mesh ? _mesh->_source.get() : nullptr; };
+
+	uint32_t get_vao() const { return _mesh ? _mesh->_vao : 0; };
+	GLsizei get_index_count() const { return _mesh ? _mesh->_index_count : 0; };
+	GLenum get_index_type() const { return _mesh ? _mesh->_index_type : GL_UNSIGNED_SHORT; };
+	ga_csg_material* get_material() { return _material; };
+
+private:
+	ga_csg_material* _material;
+	std::shared_ptr<ga_csg_gpu_mesh> _mesh;
+};
+
+#endif
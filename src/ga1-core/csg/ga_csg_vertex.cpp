@@ -21,12 +21,6 @@ ga_csg_vertex::ga_csg_vertex(ga_vec3f& p, ga_vec3f& n)
 	_normal = n;
 }
 
-ga_csg_vertex::ga_csg_vertex(const ga_csg_vertex& other)
-{
-	_pos = other._pos;
-	_normal = other._normal;
-}
-
 void ga_csg_vertex::flip()
 {
 	_normal = -_normal;
@@ -27,10 +27,13 @@ class ga_csg_vertex
 public:
 	ga_csg_vertex();
 	ga_csg_vertex(ga_vec3f& p, ga_vec3f& n);
-	ga_csg_vertex(const ga_csg_vertex& other);
-	~ga_csg_vertex() {
-
-	}
+	// Vertices are plain data, so copies and moves are trivial and vectors
+	// of them can be relocated with memcpy.
+	ga_csg_vertex(const ga_csg_vertex& other) = default;
+	ga_csg_vertex(ga_csg_vertex&& other) = default;
+	ga_csg_vertex& operator=(const ga_csg_vertex& other) = default;
+	ga_csg_vertex& operator=(ga_csg_vertex&& other) = default;
+	~ga_csg_vertex() = default;
 
 	void flip();
 	ga_csg_vertex flipped();
@@ -0,0 +1,391 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+** Evan Wallace - CSG.js - https://github.com/evanw/csg.js
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_mass_properties.h"
+#include "ga_csg_jobs.h"
+#include "ga_polygon_soup.h"
+
+#include "framework/ga_compiler_defines.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(GA_AVX2)
+#include <immintrin.h>
+#elif defined(GA_SSE2)
+#include <emmintrin.h>
+#endif
+
+// Soups with fewer polygons than this per job are summed on the calling thread.
+static const int k_parallel_mass_min_polygons = 1024;
+
+// Triangles are gathered into batches of this many before they are summed.
+// Each batch is summed in single precision and added to the double
+// precision totals, which keeps large soups accurate.
+static const int k_mass_batch_triangles = 128;
+
+/*
+** The sums over every tetrahedron (o, a, b, c), with a, b and c relative to
+** o, and d = a . (b x c), six times its signed volume:
+**   0      d
+**   1..3   d * s, where s = a + b + c
+**   4..6   d * (a.x a.x + b.x b.x + c.x c.x + s.x s.x), and likewise for y and z
+**   7..9   d * (a.x a.y + b.x b.y + c.x c.y + s.x s.y), and likewise for yz and zx
+** which are 6, 24 and 120 times its volume, first moments and second moments.
+*/
+static const int k_mass_sums = 10;
+
+// Fanned triangles as structure-of-arrays, _v[3 * vertex + axis][triangle].
+struct triangle_batch_t
+{
+	float _v[9][k_mass_batch_triangles];
+};
+
+static void sum_batch(const triangle_batch_t& batch, int count, double* sums)
+{
+	int i = 0;
+
+#if defined(GA_AVX2)
+	{
+		__m256 acc[k_mass_sums];
+		for (int k = 0; k < k_mass_sums; ++k)
+		{
+			acc[k] = _mm256_setzero_ps();
+		}
+
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 ax = _mm256_loadu_ps(&batch._v[0][i]);
+			__m256 ay = _mm256_loadu_ps(&batch._v[1][i]);
+			__m256 az = _mm256_loadu_ps(&batch._v[2][i]);
+			__m256 bx = _mm256_loadu_ps(&batch._v[3][i]);
+			__m256 by = _mm256_loadu_ps(&batch._v[4][i]);
+			__m256 bz = _mm256_loadu_ps(&batch._v[5][i]);
+			__m256 cx = _mm256_loadu_ps(&batch._v[6][i]);
+			__m256 cy = _mm256_loadu_ps(&batch._v[7][i]);
+			__m256 cz = _mm256_loadu_ps(&batch._v[8][i]);
+
+			__m256 kx = _mm256_sub_ps(_mm256_mul_ps(by, cz), _mm256_mul_ps(bz, cy));
+			__m256 ky = _mm256_sub_ps(_mm256_mul_ps(bz, cx), _mm256_mul_ps(bx, cz));
+			__m256 kz = _mm256_sub_ps(_mm256_mul_ps(bx, cy), _mm256_mul_ps(by, cx));
+			__m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax, kx), _mm256_mul_ps(ay, ky)), _mm256_mul_ps(az, kz));
+
+			__m256 sx = _mm256_add_ps(_mm256_add_ps(ax, bx), cx);
+			__m256 sy = _mm256_add_ps(_mm256_add_ps(ay, by), cy);
+			__m256 sz = _mm256_add_ps(_mm256_add_ps(az, bz), cz);
+
+			__m256 xx = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax, ax), _mm256_mul_ps(bx, bx)), _mm256_add_ps(_mm256_mul_ps(cx, cx), _mm256_mul_ps(sx, sx)));
+			__m256 yy = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ay, ay), _mm256_mul_ps(by, by)), _mm256_add_ps(_mm256_mul_ps(cy, cy), _mm256_mul_ps(sy, sy)));
+			__m256 zz = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(az, az), _mm256_mul_ps(bz, bz)), _mm256_add_ps(_mm256_mul_ps(cz, cz), _mm256_mul_ps(sz, sz)));
+			__m256 xy = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax, ay), _mm256_mul_ps(bx, by)), _mm256_add_ps(_mm256_mul_ps(cx, cy), _mm256_mul_ps(sx, sy)));
+			__m256 yz = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ay, az), _mm256_mul_ps(by, bz)), _mm256_add_ps(_mm256_mul_ps(cy, cz), _mm256_mul_ps(sy, sz)));
+			__m256 zx = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(az, ax), _mm256_mul_ps(bz, bx)), _mm256_add_ps(_mm256_mul_ps(cz, cx), _mm256_mul_ps(sz, sx)));
+
+			acc[0] = _mm256_add_ps(acc[0], d);
+			acc[1] = _mm256_add_ps(acc[1], _mm256_mul_ps(d, sx));
+			acc[2] = _mm256_add_ps(acc[2], _mm256_mul_ps(d, sy));
+			acc[3] = _mm256_add_ps(acc[3], _mm256_mul_ps(d, sz));
+			acc[4] = _mm256_add_ps(acc[4], _mm256_mul_ps(d, xx));
+			acc[5] = _mm256_add_ps(acc[5], _mm256_mul_ps(d, yy));
+			acc[6] = _mm256_add_ps(acc[6], _mm256_mul_ps(d, zz));
+			acc[7] = _mm256_add_ps(acc[7], _mm256_mul_ps(d, xy));
+			acc[8] = _mm256_add_ps(acc[8], _mm256_mul_ps(d, yz));
+			acc[9] = _mm256_add_ps(acc[9], _mm256_mul_ps(d, zx));
+		}
+
+		for (int k = 0; k < k_mass_sums; ++k)
+		{
+			float lanes[8];
+			_mm256_storeu_ps(lanes, acc[k]);
+			for (int j = 0; j < 8; ++j)
+			{
+				sums[k] += lanes[j];
+			}
+		}
+	}
+#endif
+
+#if defined(GA_SSE2)
+	{
+		__m128 acc[k_mass_sums];
+		for (int k = 0; k < k_mass_sums; ++k)
+		{
+			acc[k] = _mm_setzero_ps();
+		}
+
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 ax = _mm_loadu_ps(&batch._v[0][i]);
+			__m128 ay = _mm_loadu_ps(&batch._v[1][i]);
+			__m128 az = _mm_loadu_ps(&batch._v[2][i]);
+			__m128 bx = _mm_loadu_ps(&batch._v[3][i]);
+			__m128 by = _mm_loadu_ps(&batch._v[4][i]);
+			__m128 bz = _mm_loadu_ps(&batch._v[5][i]);
+			__m128 cx = _mm_loadu_ps(&batch._v[6][i]);
+			__m128 cy = _mm_loadu_ps(&batch._v[7][i]);
+			__m128 cz = _mm_loadu_ps(&batch._v[8][i]);
+
+			__m128 kx = _mm_sub_ps(_mm_mul_ps(by, cz), _mm_mul_ps(bz, cy));
+			__m128 ky = _mm_sub_ps(_mm_mul_ps(bz, cx), _mm_mul_ps(bx, cz));
+			__m128 kz = _mm_sub_ps(_mm_mul_ps(bx, cy), _mm_mul_ps(by, cx));
+			__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, kx), _mm_mul_ps(ay, ky)), _mm_mul_ps(az, kz));
+
+			__m128 sx = _mm_add_ps(_mm_add_ps(ax, bx), cx);
+			__m128 sy = _mm_add_ps(_mm_add_ps(ay, by), cy);
+			__m128 sz = _mm_add_ps(_mm_add_ps(az, bz), cz);
+
+			__m128 xx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, ax), _mm_mul_ps(bx, bx)), _mm_add_ps(_mm_mul_ps(cx, cx), _mm_mul_ps(sx, sx)));
+			__m128 yy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ay, ay), _mm_mul_ps(by, by)), _mm_add_ps(_mm_mul_ps(cy, cy), _mm_mul_ps(sy, sy)));
+			__m128 zz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(az, az), _mm_mul_ps(bz, bz)), _mm_add_ps(_mm_mul_ps(cz, cz), _mm_mul_ps(sz, sz)));
+			__m128 xy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, ay), _mm_mul_ps(bx, by)), _mm_add_ps(_mm_mul_ps(cx, cy), _mm_mul_ps(sx, sy)));
+			__m128 yz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ay, az), _mm_mul_ps(by, bz)), _mm_add_ps(_mm_mul_ps(cy, cz), _mm_mul_ps(sy, sz)));
+			__m128 zx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(az, ax), _mm_mul_ps(bz, bx)), _mm_add_ps(_mm_mul_ps(cz, cx), _mm_mul_ps(sz, sx)));
+
+			acc[0] = _mm_add_ps(acc[0], d);
+			acc[1] = _mm_add_ps(acc[1], _mm_mul_ps(d, sx));
+			acc[2] = _mm_add_ps(acc[2], _mm_mul_ps(d, sy));
+			acc[3] = _mm_add_ps(acc[3], _mm_mul_ps(d, sz));
+			acc[4] = _mm_add_ps(acc[4], _mm_mul_ps(d, xx));
+			acc[5] = _mm_add_ps(acc[5], _mm_mul_ps(d, yy));
+			acc[6] = _mm_add_ps(acc[6], _mm_mul_ps(d, zz));
+			acc[7] = _mm_add_ps(acc[7], _mm_mul_ps(d, xy));
+			acc[8] = _mm_add_ps(acc[8], _mm_mul_ps(d, yz));
+			acc[9] = _mm_add_ps(acc[9], _mm_mul_ps(d, zx));
+		}
+
+		for (int k = 0; k < k_mass_sums; ++k)
+		{
+			float lanes[4];
+			_mm_storeu_ps(lanes, acc[k]);
+			for (int j = 0; j < 4; ++j)
+			{
+				sums[k] += lanes[j];
+			}
+		}
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		float ax = batch._v[0][i], ay = batch._v[1][i], az = batch._v[2][i];
+		float bx = batch._v[3][i], by = batch._v[4][i], bz = batch._v[5][i];
+		float cx = batch._v[6][i], cy = batch._v[7][i], cz = batch._v[8][i];
+
+		float d = ax * (by * cz - bz * cy) + ay * (bz * cx - bx * cz) + az * (bx * cy - by * cx);
+		float sx = ax + bx + cx;
+		float sy = ay + by + cy;
+		float sz = az + bz + cz;
+
+		sums[0] += d;
+		sums[1] += d * sx;
+		sums[2] += d * sy;
+		sums[3] += d * sz;
+		sums[4] += d * (ax * ax + bx * bx + cx * cx + sx * sx);
+		sums[5] += d * (ay * ay + by * by + cy * cy + sy * sy);
+		sums[6] += d * (az * az + bz * bz + cz * cz + sz * sz);
+		sums[7] += d * (ax * ay + bx * by + cx * cy + sx * sy);
+		sums[8] += d * (ay * az + by * bz + cy * cz + sy * sz);
+		sums[9] += d * (az * ax + bz * bx + cz * cx + sz * sx);
+	}
+}
+
+// Fan the polygons from first up to, but not including, end into triangles
+// relative to origin, and add their tetrahedra to sums.
+static void sum_polygons(const ga_polygon_soup& polys, const ga_vec3f& origin, int first, int end, double* sums)
+{
+	triangle_batch_t batch;
+	int count = 0;
+
+	for (int p = first; p < end; ++p)
+	{
+		const ga_vec3f* pos = polys.get_positions(p);
+		int vertex_count = polys.get_count(p);
+		ga_vec3f a = pos[0] - origin;
+		for (int v = 1; v + 1 < vertex_count; ++v)
+		{
+			ga_vec3f b = pos[v] - origin;
+			ga_vec3f c = pos[v + 1] - origin;
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				batch._v[axis][count] = a.axes[axis];
+				batch._v[3 + axis][count] = b.axes[axis];
+				batch._v[6 + axis][count] = c.axes[axis];
+			}
+			if (++count == k_mass_batch_triangles)
+			{
+				sum_batch(batch, count, sums);
+				count = 0;
+			}
+		}
+	}
+	if (count > 0)
+	{
+		sum_batch(batch, count, sums);
+	}
+}
+
+// The upper 3x3 of a tensor, or a zero one with the rest of the identity.
+static void set_tensor(const double m[3][3], ga_mat4f& tensor)
+{
+	tensor.make_identity();
+	for (int i = 0; i < 3; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			tensor.data[i][j] = (float)m[i][j];
+		}
+	}
+}
+
+// The inertia tensor of a solid is trace(C) * I - C, where C is the matrix of
+// second moments of its volume about the same point. These convert between the two.
+static void second_moments_to_tensor(const double moments[3][3], ga_mat4f& tensor)
+{
+	double trace = moments[0][0] + moments[1][1] + moments[2][2];
+	double m[3][3];
+	for (int i = 0; i < 3; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			m[i][j] = (i == j ? trace : 0.0) - moments[i][j];
+		}
+	}
+	set_tensor(m, tensor);
+}
+
+static void tensor_to_second_moments(const ga_mat4f& tensor, double moments[3][3])
+{
+	double half_trace = 0.5 * ((double)tensor.data[0][0] + tensor.data[1][1] + tensor.data[2][2]);
+	for (int i = 0; i < 3; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			moments[i][j] = (i == j ? half_trace : 0.0) - tensor.data[i][j];
+		}
+	}
+}
+
+void ga_compute_mass_properties(const ga_polygon_soup& polys, ga_csg_mass_properties& props)
+{
+	const double zero[3][3] = {};
+	props._volume = 0.0f;
+	props._centroid = ga_vec3f::zero_vector();
+	set_tensor(zero, props._inertia_tensor);
+
+	// Sum about the center of the bounds rather than the world origin, so
+	// the tetrahedra stay small and the float sums keep their precision.
+	ga_vec3f min, max;
+	if (!polys.get_bounds(min, max)) return;
+	ga_vec3f origin = (min + max).scale_result(0.5f);
+	props._centroid = origin;
+
+	// Each run sums into its own slot, and the slots are added in order.
+	struct mass_data_t
+	{
+		const ga_polygon_soup* _polys;
+		ga_vec3f _origin;
+		std::vector<double> _sums;
+	};
+	int count = polys.size();
+	mass_data_t mass_data;
+	mass_data._polys = &polys;
+	mass_data._origin = origin;
+	mass_data._sums.resize(size_t(ga_csg_range_count(count, k_parallel_mass_min_polygons)) * k_mass_sums, 0.0);
+	ga_csg_run_ranges<mass_data_t>(count, k_parallel_mass_min_polygons, &mass_data,
+		[](mass_data_t* data, int run, int first, int end)
+	{
+		sum_polygons(*data->_polys, data->_origin, first, end, &data->_sums[size_t(run) * k_mass_sums]);
+	});
+
+	double sums[k_mass_sums] = {};
+	for (size_t i = 0; i < mass_data._sums.size(); i += k_mass_sums)
+	{
+		for (int k = 0; k < k_mass_sums; ++k)
+		{
+			sums[k] += mass_data._sums[i + k];
+		}
+	}
+
+	double volume = sums[0] / 6.0;
+	if (!(volume > 0.0)) return;
+
+	double centroid[3];
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		centroid[axis] = sums[1 + axis] / (24.0 * volume);
+	}
+
+	// Second moments about the center of the bounds, then moved to the
+	// centroid with the parallel axis theorem.
+	double moments[3][3];
+	moments[0][0] = sums[4] / 120.0;
+	moments[1][1] = sums[5] / 120.0;
+	moments[2][2] = sums[6] / 120.0;
+	moments[0][1] = moments[1][0] = sums[7] / 120.0;
+	moments[1][2] = moments[2][1] = sums[8] / 120.0;
+	moments[2][0] = moments[0][2] = sums[9] / 120.0;
+	for (int i = 0; i < 3; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			moments[i][j] -= volume * centroid[i] * centroid[j];
+		}
+	}
+
+	props._volume = (float)volume;
+	props._centroid = { (float)(origin.x + centroid[0]), (float)(origin.y + centroid[1]), (float)(origin.z + centroid[2]) };
+	second_moments_to_tensor(moments, props._inertia_tensor);
+}
+
+void ga_transform_mass_properties(
+	const ga_csg_mass_properties& props,
+	const ga_mat4f& transform,
+	ga_csg_mass_properties& out)
+{
+	// Points transform as rows, p' = p L + t, so the second moments about
+	// the centroid become |det L| L^T C L.
+	double l[3][3];
+	for (int i = 0; i < 3; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			l[i][j] = transform.data[i][j];
+		}
+	}
+	double det = l[0][0] * (l[1][1] * l[2][2] - l[1][2] * l[2][1])
+		- l[0][1] * (l[1][0] * l[2][2] - l[1][2] * l[2][0])
+		+ l[0][2] * (l[1][0] * l[2][1] - l[1][1] * l[2][0]);
+	double scale = std::fabs(det);
+
+	double moments[3][3];
+	tensor_to_second_moments(props._inertia_tensor, moments);
+
+	double result[3][3];
+	for (int a = 0; a < 3; ++a)
+	{
+		for (int b = 0; b < 3; ++b)
+		{
+			double sum = 0.0;
+			for (int i = 0; i < 3; ++i)
+			{
+				for (int j = 0; j < 3; ++j)
+				{
+					sum += l[i][a] * moments[i][j] * l[j][b];
+				}
+			}
+			result[a][b] = scale * sum;
+		}
+	}
+
+	out._volume = (float)(scale * props._volume);
+	out._centroid = transform.transform_point(props._centroid);
+	second_moments_to_tensor(result, out._inertia_tensor);
+}
@@ -0,0 +1,58 @@
+#ifndef GA_MASS_PROPERTIES_H
+#define GA_MASS_PROPERTIES_H
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+** Evan Wallace - CSG.js - https://github.com/evanw/csg.js
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "math/ga_vec3f.h"
+#include "math/ga_mat4f.h"
+
+class ga_polygon_soup;
+
+/*
+** The mass properties of a solid of uniform unit density: its volume, its
+** centroid, and its inertia tensor about the centroid, in the upper 3x3 of
+** _inertia_tensor. The tensor of a body of some other mass is this one
+** scaled by mass / _volume.
+*/
+struct ga_csg_mass_properties
+{
+	float _volume;
+	ga_vec3f _centroid;
+	ga_mat4f _inertia_tensor;
+};
+
+/*
+** Compute the mass properties of the solid bounded by a closed soup of
+** outward-facing polygons, exactly, with the divergence theorem: each
+** polygon is fanned into triangles, and each triangle makes a signed
+** tetrahedron with a point near the soup whose moments are summed.
+**
+** Triangles are summed eight at a time with AVX2, four with SSE2, and one
+** at a time otherwise. Large soups are split into runs of polygons across
+** the job system, and the runs' sums are added in order, so the result
+** does not depend on how the work was split.
+**
+** A soup that encloses no volume, such as an empty one, gets a zero
+** volume and tensor, with its centroid at the center of its bounds.
+*/
+void ga_compute_mass_properties(const ga_polygon_soup& polys, ga_csg_mass_properties& props);
+
+/*
+** Find the mass properties of a solid after it is transformed by an affine
+** matrix, from those it had before. Exact, so properties computed once for
+** a shared soup serve every transformed copy of it.
+*/
+void ga_transform_mass_properties(
+	const ga_csg_mass_properties& props,
+	const ga_mat4f& transform,
+	ga_csg_mass_properties& out);
+
+#endif
@@ -0,0 +1,158 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+** Evan Wallace - CSG.js - https://github.com/evanw/csg.js
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_mass_properties.tests.h"
+#include "ga_mass_properties.h"
+
+#include "ga_csg.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+// The sums are kept in double precision, but the triangles are summed in
+// single precision, so results are compared to this relative tolerance.
+static bool mass_equal(float a, float b)
+{
+	return std::abs(a - b) <= 1e-4f * std::max(1.0f, std::abs(b));
+}
+
+// The divergence theorem one triangle at a time, in double precision, as a
+// reference for the batched SIMD sums.
+static void reference_mass_properties(const ga_polygon_soup& polys, double& volume, double centroid[3], double tensor[3][3])
+{
+	double sums[10] = {};
+	for (int poly = 0; poly < polys.size(); poly++) {
+		const ga_vec3f* positions = polys.get_positions(poly);
+		for (int i = 1; i + 1 < polys.get_count(poly); i++) {
+			const ga_vec3f& a = positions[0];
+			const ga_vec3f& b = positions[i];
+			const ga_vec3f& c = positions[i + 1];
+			double d = double(a.x) * (double(b.y) * c.z - double(b.z) * c.y)
+				+ double(a.y) * (double(b.z) * c.x - double(b.x) * c.z)
+				+ double(a.z) * (double(b.x) * c.y - double(b.y) * c.x);
+			double s[3];
+			for (int k = 0; k < 3; k++) {
+				s[k] = double(a.axes[k]) + b.axes[k] + c.axes[k];
+			}
+			for (int k = 0; k < 3; k++) {
+				sums[1 + k] += d * s[k];
+				sums[4 + k] += d * (double(a.axes[k]) * a.axes[k] + double(b.axes[k]) * b.axes[k] + double(c.axes[k]) * c.axes[k] + s[k] * s[k]);
+				int l = (k + 1) % 3;
+				sums[7 + k] += d * (double(a.axes[k]) * a.axes[l] + double(b.axes[k]) * b.axes[l] + double(c.axes[k]) * c.axes[l] + s[k] * s[l]);
+			}
+			sums[0] += d;
+		}
+	}
+
+	volume = sums[0] / 6.0;
+	double second[3][3];
+	for (int k = 0; k < 3; k++) {
+		centroid[k] = sums[1 + k] / (24.0 * volume);
+		second[k][k] = sums[4 + k] / 120.0 - volume * centroid[k] * centroid[k];
+	}
+	for (int k = 0; k < 3; k++) {
+		int l = (k + 1) % 3;
+		second[k][l] = second[l][k] = sums[7 + k] / 120.0 - volume * centroid[k] * centroid[l];
+	}
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) {
+			tensor[i][j] = i == j ? second[(i + 1) % 3][(i + 1) % 3] + second[(i + 2) % 3][(i + 2) % 3] : -second[i][j];
+		}
+	}
+}
+
+void ga_mass_properties_unit_tests()
+{
+	// A unit cube has unit volume, its centroid at the origin, and a diagonal tensor of 1/6.
+	{
+		ga_csg cube = ga_csg::Cube();
+		const ga_csg_mass_properties& props = cube.get_mass_properties();
+
+		assert(mass_equal(props._volume, 1.0f));
+		assert(props._centroid.mag2() < 1e-8f);
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++) {
+				assert(mass_equal(props._inertia_tensor.data[i][j], i == j ? 1.0f / 6.0f : 0.0f));
+			}
+		}
+	}
+
+	// Scaling and moving the cube transforms its properties.
+	{
+		ga_csg box = ga_csg::Cube();
+		box.set_scale({ 2.0f, 1.0f, 1.0f });
+		box.set_pos({ 3.0f, -1.0f, 0.5f });
+		const ga_csg_mass_properties& props = box.get_mass_properties();
+
+		assert(mass_equal(props._volume, 2.0f));
+		assert(mass_equal(props._centroid.x, 3.0f));
+		assert(mass_equal(props._centroid.y, -1.0f));
+		assert(mass_equal(props._centroid.z, 0.5f));
+		assert(mass_equal(props._inertia_tensor.data[0][0], 1.0f / 3.0f));
+		assert(mass_equal(props._inertia_tensor.data[1][1], 5.0f / 6.0f));
+		assert(mass_equal(props._inertia_tensor.data[2][2], 5.0f / 6.0f));
+		assert(mass_equal(props._inertia_tensor.data[0][1], 0.0f));
+
+		// A rigid body's tensor is scaled to its mass.
+		ga_mat4f tensor;
+		box.get_inertia_tensor(tensor, 4.0f);
+		assert(mass_equal(tensor.data[0][0], 2.0f / 3.0f));
+		assert(mass_equal(tensor.data[1][1], 5.0f / 3.0f));
+	}
+
+	// Two unit cubes overlapping by an eighth of a cube.
+	{
+		ga_csg a = ga_csg::Cube();
+		ga_csg b = ga_csg::Cube();
+		b.set_pos({ 0.5f, 0.5f, 0.5f });
+		ga_csg both = a.add(b);
+		const ga_csg_mass_properties& props = both.get_mass_properties();
+
+		assert(mass_equal(props._volume, 1.875f));
+		// Symmetric about the line through both centers.
+		assert(mass_equal(props._centroid.x, 0.25f));
+		assert(mass_equal(props._centroid.y, 0.25f));
+		assert(mass_equal(props._centroid.z, 0.25f));
+	}
+
+	// The batched sums, with AVX2 or SSE2 where they are enabled, match one
+	// triangle at a time in double precision.
+	{
+		ga_csg sphere(ga_csg::Shape::SPHERE);
+		const ga_polygon_soup& polys = sphere.get_polygon_soup();
+		ga_csg_mass_properties props;
+		ga_compute_mass_properties(polys, props);
+
+		double volume;
+		double centroid[3];
+		double tensor[3][3];
+		reference_mass_properties(polys, volume, centroid, tensor);
+
+		assert(mass_equal(props._volume, float(volume)));
+		for (int i = 0; i < 3; i++) {
+			assert(std::abs(props._centroid.axes[i] - float(centroid[i])) < 1e-5f);
+			for (int j = 0; j < 3; j++) {
+				assert(std::abs(props._inertia_tensor.data[i][j] - float(tensor[i][j])) < 1e-4f * float(tensor[0][0]));
+			}
+		}
+	}
+
+	// A soup with nothing in it has no volume.
+	{
+		ga_polygon_soup empty;
+		ga_csg_mass_properties props;
+		ga_compute_mass_properties(empty, props);
+
+		assert(props._volume == 0.0f);
+		assert(props._inertia_tensor.data[0][0] == 0.0f);
+	}
+}
@@ -9,106 +9,586 @@
 */
 
 #include "ga_node.h"
+#include "ga_csg_jobs.h"
 
-ga_node::ga_node(ga_node& other)
-{
-	_plane = new ga_csg_plane(*(other._plane));
-	_front = new ga_node(*(other._front));
-	_back = new ga_node(*(other._back));
-	for (int i = 0; i < other._polygons.size(); i++) {
-		_polygons.push_back(ga_polygon(other._polygons[i]));
-	}
-}
+#include "ga_plane_classify.h"
+
+#include "jobs/ga_job.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+// Subtrees with fewer polygons than this are not worth a job.
+static const int k_parallel_build_min_polygons = 256;
+
+// Clipping forks a job for a subtree or a run of nodes with at least this many polygons.
+static const int k_parallel_clip_min_polygons = 128;
+
+// The SAMPLED split heuristic scores each candidate against at most this many polygons.
+static const int k_split_score_polygons = 256;
 
-ga_node::ga_node(std::vector<ga_polygon>& polys)
+// Only the top levels of the tree fork jobs. Each fork holds a fiber while it
+// waits on its child, so this bounds the fibers a single build or clip can take.
+static const int k_parallel_max_depth = 6;
+
+ga_node::ga_node(ga_csg_arena* arena, const ga_polygon_soup& polys, const ga_bsp_options& options)
 {
-	_plane = nullptr;
+	_arena = arena;
+	_plane = ga_csg_plane_table::k_none;
 	_front = nullptr;
 	_back = nullptr;
-	if (polys.size() > 0) build(polys);
+	if (polys.size() > 0) build(polys, options);
+}
+
+ga_node* ga_node::clone() const
+{
+	// Trees can be as deep as they have polygons, so every traversal below
+	// uses an explicit stack rather than recursion, which would overflow
+	// the small stacks jobs run on.
+	std::vector<std::pair<const ga_node*, ga_node*>> stack;
+	ga_node* root = _arena->create<ga_node>(_arena);
+	stack.push_back(std::make_pair(this, root));
+	while (!stack.empty()) {
+		const ga_node* node = stack.back().first;
+		ga_node* temp = stack.back().second;
+		stack.pop_back();
+		temp->_plane = node->_plane;
+		temp->_planes = node->_planes;
+		temp->_polygons = node->_polygons;
+		if (node->_front) {
+			temp->_front = _arena->create<ga_node>(_arena);
+			stack.push_back(std::make_pair(node->_front, temp->_front));
+		}
+		if (node->_back) {
+			temp->_back = _arena->create<ga_node>(_arena);
+			stack.push_back(std::make_pair(node->_back, temp->_back));
+		}
+	}
+	return root;
 }
 
 void ga_node::invert()
 {
-	// flip all polygons
-	for (int i = 0; i < _polygons.size(); i++) {
-		_polygons[i].flip();
+	std::vector<ga_node*> stack;
+	stack.push_back(this);
+	while (!stack.empty()) {
+		ga_node* node = stack.back();
+		stack.pop_back();
+		// flip all polygons
+		node->_polygons.flip();
+		// also flip plane, which is stored next to its flip
+		if (node->has_plane()) node->_plane ^= 1;
+		// swap 
+		ga_node* temp = node->_front;
+		node->_front = node->_back;
+		node->_back = temp;
+		if (node->_front) stack.push_back(node->_front);
+		if (node->_back) stack.push_back(node->_back);
 	}
-	// also flip plane
-	_plane->flip();
-	// recursively invert
-	if (_front) _front->invert();
-	if (_back) _back->invert();
-	// swap 
-	ga_node* temp = _front;
-	_front = _back;
-	_back = temp;
 }
 
-ga_node ga_node::inverted()
+ga_node* ga_node::inverted() const
 {
-	ga_node temp = ga_node(*this);
-	temp.invert();
+	ga_node* temp = clone();
+	temp->invert();
 	return temp;
 }
 
 void ga_node::clip_to(ga_node& bsp)
 {
-	_polygons = bsp.clip_polygons(_polygons);
-	if (_front) _front->clip_to(bsp);
-	if (_back) _back->clip_to(bsp);
+	clip_to(ga_bsp_flat(bsp));
+}
+
+void ga_node::clip_to(const ga_bsp_flat& bsp)
+{
+	// Every node's polygon list is clipped independently, so gather the
+	// nodes in tree order and clip runs of them on separate workers.
+	std::vector<ga_node*> nodes;
+	int polygon_count = 0;
+	std::vector<ga_node*> stack;
+	stack.push_back(this);
+	while (!stack.empty()) {
+		ga_node* node = stack.back();
+		stack.pop_back();
+		nodes.push_back(node);
+		polygon_count += node->_polygons.size();
+		if (node->_back) stack.push_back(node->_back);
+		if (node->_front) stack.push_back(node->_front);
+	}
+
+	// The runs are split by polygons, not nodes, and each run clips the nodes
+	// whose polygons start inside it.
+	struct clip_data_t
+	{
+		ga_node** _nodes;
+		std::vector<int> _starts;
+		const ga_bsp_flat* _bsp;
+	};
+	clip_data_t clip_data;
+	clip_data._nodes = nodes.data();
+	clip_data._bsp = &bsp;
+	clip_data._starts.resize(nodes.size());
+	for (int i = 0, start = 0; i < nodes.size(); i++) {
+		clip_data._starts[i] = start;
+		start += nodes[i]->_polygons.size();
+	}
+
+	ga_csg_run_ranges<clip_data_t>(polygon_count, k_parallel_clip_min_polygons, &clip_data,
+		[](clip_data_t* data, int first, int end)
+	{
+		// The runs already cover the workers, so each clip stays serial.
+		auto it = std::lower_bound(data->_starts.begin(), data->_starts.end(), first);
+		for (; it != data->_starts.end() && *it < end; ++it) {
+			ga_node* node = data->_nodes[it - data->_starts.begin()];
+			ga_polygon_soup clipped;
+			data->_bsp->clip_subtree(0, node->_polygons, false, k_parallel_max_depth, clipped);
+			node->_polygons = std::move(clipped);
+		}
+	});
+}
+
+ga_polygon_soup ga_node::clip_polygons(const ga_polygon_soup& polys)
+{
+	return clip_polygons(polys, false);
+}
+
+ga_polygon_soup ga_node::clip_polygons(const ga_polygon_soup& polys, bool inverted) const
+{
+	ga_polygon_soup out;
+	clip_polygons(polys, inverted, out);
+	return out;
+}
+
+void ga_node::clip_polygons(const ga_polygon_soup& polys, bool inverted, ga_polygon_soup& out) const
+{
+	ga_bsp_flat(*this).clip_polygons(polys, inverted, out);
+}
+
+ga_polygon_soup ga_node::all_polygons()
+{
+	ga_polygon_soup polygons;
+	all_polygons(polygons);
+	return polygons;
+}
+
+void ga_node::all_polygons(ga_polygon_soup& out) const
+{
+	std::vector<const ga_node*> stack;
+	stack.push_back(this);
+	while (!stack.empty()) {
+		const ga_node* node = stack.back();
+		stack.pop_back();
+		out.append(node->_polygons);
+		if (node->_back) stack.push_back(node->_back);
+		if (node->_front) stack.push_back(node->_front);
+	}
+}
+
+void ga_bsp_flat::clear()
+{
+	_normal_x.clear();
+	_normal_y.clear();
+	_normal_z.clear();
+	_w.clear();
+	_children.clear();
+}
+
+void ga_bsp_flat::freeze(const ga_node& root)
+{
+	clear();
+	if (!root.has_plane()) return;
+
+	// Number the nodes as they are queued, so each level follows the one
+	// above it and a node's children are next to each other.
+	std::vector<const ga_node*> queue;
+	queue.push_back(&root);
+	for (int i = 0; i < queue.size(); i++) {
+		const ga_node* node = queue[i];
+		const ga_csg_plane& plane = node->get_plane();
+		_normal_x.push_back(plane._normal.x);
+		_normal_y.push_back(plane._normal.y);
+		_normal_z.push_back(plane._normal.z);
+		_w.push_back(plane._w);
+
+		// Every node below the root has polygons, so it has a plane.
+		int32_t front = k_none;
+		int32_t back = k_none;
+		if (node->_front) {
+			front = int32_t(queue.size());
+			queue.push_back(node->_front);
+		}
+		if (node->_back) {
+			back = int32_t(queue.size());
+			queue.push_back(node->_back);
+		}
+		_children.push_back(front);
+		_children.push_back(back);
+	}
+}
+
+ga_csg_plane ga_bsp_flat::get_plane(int node) const
+{
+	ga_csg_plane plane;
+	plane._normal = { _normal_x[node], _normal_y[node], _normal_z[node] };
+	plane._w = _w[node];
+	return plane;
+}
+
+ga_polygon_soup ga_bsp_flat::clip_polygons(const ga_polygon_soup& polys, bool inverted) const
+{
+	ga_polygon_soup out;
+	clip_subtree(0, polys, inverted, 0, out);
+	return out;
+}
+
+void ga_bsp_flat::clip_polygons(const ga_polygon_soup& polys, bool inverted, ga_polygon_soup& out) const
+{
+	clip_subtree(0, polys, inverted, 0, out);
 }
 
-std::vector<ga_polygon> ga_node::clip_polygons(std::vector<ga_polygon>& polys)
+void ga_bsp_flat::clip_subtree(int node, const ga_polygon_soup& polys, bool inverted, int depth, ga_polygon_soup& out) const
 {
-	if (!_plane) 
-		return std::vector<ga_polygon>(_polygons);
-	std::vector<ga_polygon> front;
-	std::vector<ga_polygon> back;
-	for (int i = 0; i < _polygons.size(); i++) {
-		split_polygon(*_plane, _polygons[i], front, back, front, back);
+	if (empty()) {
+		out.append(polys);
+		return;
+	}
+
+	// Subtrees still to clip. The back half of a node is pushed before the
+	// front half, so front results are always output first.
+	struct clip_item_t
+	{
+		int _node;
+		ga_polygon_soup _polys;
+		int _depth;
+	};
+	std::vector<clip_item_t> stack;
+
+	const ga_polygon_soup* current = &polys;
+	ga_polygon_soup popped;
+	for (;;) {
+		int front_node = get_front(node, inverted);
+		int back_node = get_back(node, inverted);
+
+		ga_polygon_soup front_polys;
+		ga_polygon_soup back;
+		split_for_clip(node, *current, 0, current->size(), inverted, out, front_polys, back);
+
+		bool parallel = ga_job::is_running()
+			&& depth < k_parallel_max_depth
+			&& front_node != k_none && back_node != k_none
+			&& front_polys.size() >= k_parallel_clip_min_polygons
+			&& back.size() >= k_parallel_clip_min_polygons;
+
+		if (parallel) {
+			// Forking only happens in the top levels, so this recursion is shallow.
+			struct clip_data_t
+			{
+				const ga_bsp_flat* _tree;
+				int _node;
+				const ga_polygon_soup* _polys;
+				bool _inverted;
+				int _depth;
+				ga_polygon_soup _out;
+			};
+			clip_data_t clip_data;
+			clip_data._tree = this;
+			clip_data._node = back_node;
+			clip_data._polys = &back;
+			clip_data._inverted = inverted;
+			clip_data._depth = depth + 1;
+
+			ga_job_decl_t decl;
+			decl._data = &clip_data;
+			decl._entry = [](void* data)
+			{
+				auto clip_data = static_cast<clip_data_t*>(data);
+				clip_data->_tree->clip_subtree(clip_data->_node, *clip_data->_polys, clip_data->_inverted,
+					clip_data->_depth, clip_data->_out);
+			};
+
+			int32_t counter;
+			ga_job::run(&decl, 1, &counter);
+			clip_subtree(front_node, front_polys, inverted, depth + 1, out);
+			ga_job::wait(&counter);
+			out.append(clip_data._out);
+		}
+		else {
+			// Polygons behind a leaf are inside the solid and dropped. Empty
+			// halves are not pushed at all, since nothing below can come of them.
+			if (back_node != k_none && !back.empty()) {
+				clip_item_t item;
+				item._node = back_node;
+				item._polys = std::move(back);
+				item._depth = depth + 1;
+				stack.push_back(std::move(item));
+			}
+			if (front_node != k_none && !front_polys.empty()) {
+				clip_item_t item;
+				item._node = front_node;
+				item._polys = std::move(front_polys);
+				item._depth = depth + 1;
+				stack.push_back(std::move(item));
+			}
+		}
+
+		if (stack.empty()) break;
+		node = stack.back()._node;
+		depth = stack.back()._depth;
+		popped = std::move(stack.back()._polys);
+		current = &popped;
+		stack.pop_back();
 	}
-	if (_front) front = _front->clip_polygons(front);
-	if (_back) back = _back->clip_polygons(back);
-	else back.clear();
-	// front.concat(back)
-	front.insert(front.end(), back.begin(), back.end());
-	return front;
 }
 
-std::vector<ga_polygon> ga_node::all_polygons()
+void ga_bsp_flat::split_for_clip(int node, const ga_polygon_soup& polys, int first, int end, bool inverted,
+	ga_polygon_soup& out, ga_polygon_soup& front, ga_polygon_soup& back) const
+{
+	// An inverted node has the opposite plane and its children swapped, so
+	// the sides trade places. Classification is symmetric about the plane,
+	// which makes this exactly what splitting by the flipped plane gives.
+	// Polygons in front of a leaf are kept as they are, so they are split
+	// straight into the output.
+	ga_csg_plane plane = get_plane(node);
+	ga_polygon_soup& front_target = get_front(node, inverted) != k_none ? front : out;
+	if (inverted) split_polygons(plane, polys, first, end, back, front_target, back, front_target);
+	else split_polygons(plane, polys, first, end, front_target, back, front_target, back);
+}
+
+// Polygons split by each step of a ga_node_build_task or ga_node_clip_task.
+static const int k_task_step_polygons = 256;
+
+// Pick the polygon whose plane the node should split along.
+static int choose_split_polygon(const ga_polygon_soup& polys, const ga_bsp_options& options)
 {
-	std::vector<ga_polygon> polygons = _polygons;
-	if (_front) {
-		std::vector<ga_polygon> temp = _front->all_polygons();
-		if (temp.size() != 0) {
-			polygons.insert(polygons.end(), temp.begin(), temp.end());
+	if (options._split == ga_bsp_options::Split::FIRST || polys.size() < 2) return 0;
+
+	const int k_max_vertices = 64;
+	float distances[k_max_vertices];
+	uint8_t sides[k_max_vertices];
+
+	int candidates = std::min(options._sample_count, polys.size());
+	int scored = std::min(k_split_score_polygons, polys.size());
+
+	int best = 0;
+	float best_score = INFINITY;
+	uint32_t last_index = ga_csg_plane_table::k_none;
+	for (int c = 0; c < candidates; c++) {
+		int candidate = (int)((int64_t)c * polys.size() / candidates);
+		// Neighbouring fragments of one face share a plane, and would score the same.
+		if (polys.get_plane_index(candidate) == last_index) continue;
+		last_index = polys.get_plane_index(candidate);
+		const ga_csg_plane& plane = polys.get_plane(candidate);
+
+		int front = 0, back = 0, spanning = 0;
+		for (int i = 0; i < scored; i++) {
+			int poly = (int)((int64_t)i * polys.size() / scored);
+			int count = std::min(polys.get_count(poly), k_max_vertices);
+			switch (ga_csg_classify_points(plane, polys.get_positions(poly), count, distances, sides)) {
+			case k_csg_front: front++; break;
+			case k_csg_back: back++; break;
+			case k_csg_spanning: spanning++; break;
+			}
 		}
+
+		float score = options._split_weight * spanning + options._balance_weight * std::abs(front - back);
+		if (score < best_score) {
+			best_score = score;
+			best = candidate;
+		}
+	}
+	return best;
+}
+
+void ga_node::split_for_build(const ga_polygon_soup& polys, int first, int end, const ga_bsp_options& options,
+	ga_polygon_soup& front, ga_polygon_soup& back)
+{
+	if (!has_plane()) {
+		int split = choose_split_polygon(polys, options);
+		_plane = polys.get_plane_index(split);
+		_planes = polys._planes;
+	}
+	// Polygons built from the same table are sorted onto the node's own plane
+	// by index, before anything is classified against it.
+	if (polys.get_plane_table() == _planes.get()) {
+		split_polygons(_plane, polys, first, end, _polygons, _polygons, front, back);
+	}
+	else {
+		split_polygons(get_plane(), polys, first, end, _polygons, _polygons, front, back);
+	}
+	if (front.size() != 0) {
+		if (!_front) _front = _arena->create<ga_node>(_arena);
+	}
+	if (back.size() != 0) {
+		if (!_back) _back = _arena->create<ga_node>(_arena);
 	}
-	if (_back) {
-		std::vector<ga_polygon> temp = _back->all_polygons();
-		if (temp.size() != 0) {
-			polygons.insert(polygons.end(), temp.begin(), temp.end());
+}
+
+void ga_node::build(const ga_polygon_soup& polys, const ga_bsp_options& options)
+{
+	build(polys, options, 0);
+}
+
+void ga_node::build(const ga_polygon_soup& polys, const ga_bsp_options& options, int depth)
+{
+	// Subtrees still to build, front halves on top so the tree is built in
+	// the same order as a recursive build would.
+	struct build_item_t
+	{
+		ga_node* _node;
+		ga_polygon_soup _polys;
+		int _depth;
+	};
+	std::vector<build_item_t> stack;
+
+	ga_node* node = this;
+	const ga_polygon_soup* current = &polys;
+	ga_polygon_soup popped;
+	for (;;) {
+		if (current->size() != 0) {
+			ga_polygon_soup front;
+			ga_polygon_soup back;
+			node->split_for_build(*current, 0, current->size(), options, front, back);
+
+			// The two halves are independent once partitioned. Hand the back half to
+			// another worker and build the front half on this one. Forking only
+			// happens in the top levels, so this recursion is shallow.
+			bool parallel = ga_job::is_running()
+				&& depth < k_parallel_max_depth
+				&& front.size() >= k_parallel_build_min_polygons
+				&& back.size() >= k_parallel_build_min_polygons;
+
+			if (parallel) {
+				struct build_data_t
+				{
+					ga_node* _node;
+					const ga_polygon_soup* _polys;
+					const ga_bsp_options* _options;
+					int _depth;
+				};
+				build_data_t build_data;
+				build_data._node = node->_back;
+				build_data._polys = &back;
+				build_data._options = &options;
+				build_data._depth = depth + 1;
+
+				ga_job_decl_t decl;
+				decl._data = &build_data;
+				decl._entry = [](void* data)
+				{
+					auto build_data = static_cast<build_data_t*>(data);
+					build_data->_node->build(*build_data->_polys, *build_data->_options, build_data->_depth);
+				};
+
+				int32_t counter;
+				ga_job::run(&decl, 1, &counter);
+				node->_front->build(front, options, depth + 1);
+				ga_job::wait(&counter);
+			}
+			else {
+				if (back.size() != 0) {
+					build_item_t item;
+					item._node = node->_back;
+					item._polys = std::move(back);
+					item._depth = depth + 1;
+					stack.push_back(std::move(item));
+				}
+				if (front.size() != 0) {
+					build_item_t item;
+					item._node = node->_front;
+					item._polys = std::move(front);
+					item._depth = depth + 1;
+					stack.push_back(std::move(item));
+				}
+			}
 		}
+
+		if (stack.empty()) break;
+		node = stack.back()._node;
+		depth = stack.back()._depth;
+		popped = std::move(stack.back()._polys);
+		current = &popped;
+		stack.pop_back();
 	}
-	return polygons;
 }
 
-void ga_node::build(std::vector<ga_polygon>& polys)
+void ga_node_build_task::start(ga_node* root, ga_polygon_soup polys, const ga_bsp_options& options)
 {
+	_stack.clear();
+	_options = options;
 	if (polys.size() == 0) return;
-	if (!_plane) _plane = new ga_csg_plane(polys[0]._plane);
-	std::vector<ga_polygon> front;
-	std::vector<ga_polygon> back;
-	for (int i = 0; i < polys.size(); i++) {
-		split_polygon(*_plane, polys[i], _polygons, _polygons, front, back);
+	_stack.emplace_back();
+	_stack.back()._node = root;
+	_stack.back()._polys = std::move(polys);
+}
+
+bool ga_node_build_task::step()
+{
+	if (_stack.empty()) return true;
+	item_t& item = _stack.back();
+	int end = std::min(item._next + k_task_step_polygons, item._polys.size());
+	item._node->split_for_build(item._polys, item._next, end, _options, item._front, item._back);
+	item._next = end;
+	if (end < item._polys.size()) return false;
+
+	ga_node* node = item._node;
+	ga_polygon_soup front = std::move(item._front);
+	ga_polygon_soup back = std::move(item._back);
+	_stack.pop_back();
+	if (back.size() != 0) {
+		_stack.emplace_back();
+		_stack.back()._node = node->_back;
+		_stack.back()._polys = std::move(back);
 	}
 	if (front.size() != 0) {
-		if (!_front) _front = new ga_node();
-		_front->build(front);
+		_stack.emplace_back();
+		_stack.back()._node = node->_front;
+		_stack.back()._polys = std::move(front);
 	}
-	if (back.size() != 0) {
-		if (!_back) _back = new ga_node();
-		_back->build(back);
+	return _stack.empty();
+}
+
+void ga_node_clip_task::start(const ga_bsp_flat* tree, ga_polygon_soup polys, bool inverted, ga_polygon_soup* out)
+{
+	_stack.clear();
+	_tree = tree;
+	_inverted = inverted;
+	_out = out;
+	if (polys.size() == 0) return;
+	if (tree->empty()) {
+		_out->append(polys);
+		return;
+	}
+	_stack.emplace_back();
+	_stack.back()._node = 0;
+	_stack.back()._polys = std::move(polys);
+}
+
+bool ga_node_clip_task::step()
+{
+	if (_stack.empty()) return true;
+	item_t& item = _stack.back();
+	int node = item._node;
+	int end = std::min(item._next + k_task_step_polygons, item._polys.size());
+	_tree->split_for_clip(node, item._polys, item._next, end, _inverted, *_out, item._front, item._back);
+	item._next = end;
+	if (end < item._polys.size()) return false;
+
+	int front_node = _tree->get_front(node, _inverted);
+	int back_node = _tree->get_back(node, _inverted);
+	ga_polygon_soup front = std::move(item._front);
+	ga_polygon_soup back = std::move(item._back);
+	_stack.pop_back();
+	if (back_node != ga_bsp_flat::k_none && !back.empty()) {
+		_stack.emplace_back();
+		_stack.back()._node = back_node;
+		_stack.back()._polys = std::move(back);
+	}
+	if (front_node != ga_bsp_flat::k_none && !front.empty()) {
+		_stack.emplace_back();
+		_stack.back()._node = front_node;
+		_stack.back()._polys = std::move(front);
 	}
+	return _stack.empty();
 }
@@ -13,7 +13,35 @@
 ** This file is distributed under the MIT License. See LICENSE.txt.
 */
 
-#include "ga_csg_polygon.h"
+#include "ga_polygon_soup.h"
+#include "ga_csg_arena.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class ga_bsp_flat;
+struct ga_csg_ray;
+struct ga_csg_ray_hit;
+
+/*
+** Controls how ga_node::build picks the plane each node splits along.
+**
+** FIRST splits along the first polygon's plane, as csg.js does.
+** SAMPLED scores evenly spaced candidate planes against a sample of the
+** polygons and keeps the one with the lowest
+**     split_weight * splits + balance_weight * |front - back|
+** which keeps trees shallow and avoids cutting polygons into fragments.
+*/
+struct ga_bsp_options
+{
+	enum class Split { FIRST, SAMPLED };
+
+	Split _split = Split::SAMPLED;
+	int _sample_count = 16;
+	float _split_weight = 8.0f;
+	float _balance_weight = 1.0f;
+};
 
 /*
 Holds a node in a BSP tree. A BSP tree is built from a collection of polygons
@@ -21,32 +49,214 @@ by picking a polygon to split along. That polygon (and all other coplanar
 polygons) are added directly to that node and the other polygons are added to
 the front and/or back subtrees. This is not a leafy BSP tree since there is
 no distinction between internal and leaf nodes.
+
+Nodes live in a ga_csg_arena owned by the operation that builds the tree;
+their polygon soups are ordinary heap-backed members, freed when the arena
+destroys the node. Child nodes are created in the same arena as their
+parent, and the whole tree is released when the arena goes away. A node's
+plane is an index into the plane table of the polygons it was built from,
+which the node shares, so polygons on the node's plane are found by index.
 */
 class ga_node
 {
 public:
-	ga_node() {
-		_plane = nullptr;
+	ga_node(ga_csg_arena* arena) {
+		_arena = arena;
+		_plane = ga_csg_plane_table::k_none;
 		_front = nullptr;
 		_back = nullptr;
 	}
-	ga_node(ga_node& other);
-	ga_node(std::vector<ga_polygon>& polys);
+	ga_node(ga_csg_arena* arena, const ga_polygon_soup& polys, const ga_bsp_options& options = ga_bsp_options());
 	~ga_node() { }
 
+	ga_node* clone() const;
+
 	void invert();
-	ga_node inverted();
+	ga_node* inverted() const;
 
+	/*
+	** Remove the parts of this tree's polygons that are inside bsp.
+	** Nodes are clipped in parallel when the job system is running; every
+	** node's result is the same as a serial clip. The first version freezes
+	** bsp into a ga_bsp_flat once and clips against that.
+	*/
 	void clip_to(ga_node& bsp);
-	std::vector<ga_polygon> clip_polygons(std::vector<ga_polygon>& polys);
-	std::vector<ga_polygon> all_polygons();
+	void clip_to(const ga_bsp_flat& bsp);
+
+	/*
+	** Remove the parts of polys that are inside this tree. Large front and
+	** back subtrees are clipped in parallel, and the output keeps the serial
+	** order: front results first, then back results.
+	**
+	** The tree is frozen into a ga_bsp_flat for every call; to clip against
+	** one tree many times, freeze it once and clip against that instead.
+	*/
+	ga_polygon_soup clip_polygons(const ga_polygon_soup& polys);
+
+	/*
+	** Same as above, but optionally clips as if the tree had been inverted,
+	** without modifying or copying it. This lets one tree be shared by every
+	** operation that needs it, in either orientation.
+	*/
+	ga_polygon_soup clip_polygons(const ga_polygon_soup& polys, bool inverted) const;
 
-	void build(std::vector<ga_polygon>& polys);
+	/*
+	** Sink versions of clip_polygons and all_polygons: the results are
+	** appended to out, which must not be polys. Each polygon is copied once,
+	** straight into out, instead of once per level of the tree.
+	*/
+	void clip_polygons(const ga_polygon_soup& polys, bool inverted, ga_polygon_soup& out) const;
+	void all_polygons(ga_polygon_soup& out) const;
 
-	ga_csg_plane* _plane;
+	ga_polygon_soup all_polygons();
+
+	/*
+	** Add polygons to the tree. Large subtrees are built in parallel on the
+	** job system when it is running, and serially otherwise.
+	*/
+	void build(const ga_polygon_soup& polys, const ga_bsp_options& options = ga_bsp_options());
+
+	bool has_plane() const { return _plane != ga_csg_plane_table::k_none; }
+	const ga_csg_plane& get_plane() const { return _planes->get(_plane); }
+
+	ga_csg_arena* _arena;
+	uint32_t _plane;
+	std::shared_ptr<const ga_csg_plane_table> _planes;
 	ga_node* _front;
 	ga_node* _back;
-	std::vector<ga_polygon> _polygons;
+	ga_polygon_soup _polygons;
+
+private:
+	friend class ga_node_build_task;
+
+	void build(const ga_polygon_soup& polys, const ga_bsp_options& options, int depth);
+
+	// The work done at one node by build, for the polygons from first up to
+	// end. Chooses the node's plane from all of polys and creates its
+	// children as needed.
+	void split_for_build(const ga_polygon_soup& polys, int first, int end, const ga_bsp_options& options,
+		ga_polygon_soup& front, ga_polygon_soup& back);
+
+	ga_node(const ga_node&) = delete;
+	ga_node& operator=(const ga_node&) = delete;
+};
+
+/*
+** A BSP tree frozen into flat arrays, for a tree that is only clipped
+** against once it is built.
+**
+** Clipping walks a ga_node tree by chasing pointers into nodes scattered
+** through the arena, each of which sits next to its polygons. Here the nodes
+** are numbered in breadth-first order from the root at 0, so the top levels
+** every clip passes through share a handful of cache lines. The plane
+** normals and offsets are kept in separate arrays, and the children of node
+** i are the 32-bit indices at 2i (front) and 2i + 1 (back), k_none where
+** there is no child. Only planes are kept; the polygons stay with the tree
+** the flat one was frozen from, which can be released afterwards.
+**
+** An empty flat tree clips nothing, as a ga_node without a plane does.
+*/
+class ga_bsp_flat
+{
+public:
+	static const int32_t k_none = -1;
+
+	ga_bsp_flat() {}
+	explicit ga_bsp_flat(const ga_node& root) { freeze(root); }
+
+	/*
+	** Replace the contents with the planes and shape of the tree at root.
+	*/
+	void freeze(const ga_node& root);
+	void clear();
+
+	int size() const { return (int)_w.size(); }
+	bool empty() const { return _w.empty(); }
+
+	ga_csg_plane get_plane(int node) const;
+	int get_front(int node, bool inverted) const { return _children[2 * node + (inverted ? 1 : 0)]; }
+	int get_back(int node, bool inverted) const { return _children[2 * node + (inverted ? 0 : 1)]; }
+
+	/*
+	** Same as ga_node::clip_polygons, against the frozen tree.
+	*/
+	ga_polygon_soup clip_polygons(const ga_polygon_soup& polys, bool inverted = false) const;
+	void clip_polygons(const ga_polygon_soup& polys, bool inverted, ga_polygon_soup& out) const;
+
+private:
+	friend class ga_node;
+	friend class ga_node_clip_task;
+	// The queries in ga_bsp_query.h read the arrays directly.
+	friend void ga_bsp_contains_points(const ga_bsp_flat& bsp, const ga_vec3f* points, int count, bool* inside);
+	friend void ga_bsp_raycast(const ga_bsp_flat& bsp, const ga_csg_ray* rays, int count, ga_csg_ray_hit* hits);
+
+	// Clips polys against the subtree at node; depth is how many levels of
+	// forking are above it.
+	void clip_subtree(int node, const ga_polygon_soup& polys, bool inverted, int depth, ga_polygon_soup& out) const;
+
+	// The work done at one node by clip_polygons, for the polygons from first
+	// up to end. Polygons kept in front of a missing child go straight to out.
+	void split_for_clip(int node, const ga_polygon_soup& polys, int first, int end, bool inverted,
+		ga_polygon_soup& out, ga_polygon_soup& front, ga_polygon_soup& back) const;
+
+	std::vector<float> _normal_x;
+	std::vector<float> _normal_y;
+	std::vector<float> _normal_z;
+	std::vector<float> _w;
+	std::vector<int32_t> _children;
+};
+
+/*
+** ga_node::build and ga_bsp_flat::clip_polygons broken into bounded steps, for operations
+** that are time-sliced on one thread rather than run on the job system.
+** Each step splits at most a fixed number of polygons at a single node; the
+** stack of subtrees still to visit, and the halves of the node being split,
+** are kept between steps, so a task can be resumed on a later frame.
+** Tasks never fork jobs, and give the same results as the serial calls.
+*/
+class ga_node_build_task
+{
+public:
+	void start(ga_node* root, ga_polygon_soup polys, const ga_bsp_options& options);
+	// Returns true once the whole tree is built.
+	bool step();
+	bool is_done() const { return _stack.empty(); }
+
+private:
+	struct item_t
+	{
+		ga_node* _node;
+		ga_polygon_soup _polys;
+		int _next = 0;
+		ga_polygon_soup _front;
+		ga_polygon_soup _back;
+	};
+	std::vector<item_t> _stack;
+	ga_bsp_options _options;
+};
+
+class ga_node_clip_task
+{
+public:
+	// The kept polygons are appended to out. The tree and out must outlive the task.
+	void start(const ga_bsp_flat* tree, ga_polygon_soup polys, bool inverted, ga_polygon_soup* out);
+	// Returns true once every polygon has been clipped.
+	bool step();
+	bool is_done() const { return _stack.empty(); }
+
+private:
+	struct item_t
+	{
+		int _node;
+		ga_polygon_soup _polys;
+		int _next = 0;
+		ga_polygon_soup _front;
+		ga_polygon_soup _back;
+	};
+	std::vector<item_t> _stack;
+	const ga_bsp_flat* _tree = nullptr;
+	bool _inverted = false;
+	ga_polygon_soup* _out = nullptr;
 };
 
 #endif
\ No newline at end of file
@@ -10,26 +10,21 @@
 
 #include "ga_plane.h"
 
+#include <cstring>
+
+const float ga_csg_plane::EPSILON = .00001f;
+
 ga_csg_plane::ga_csg_plane()
 {
     _normal = ga_vec3f::zero_vector();
     _w = 0.0f;
 }
-ga_csg_plane::~ga_csg_plane()
-{
-}
 
 ga_csg_plane::ga_csg_plane(ga_vec3f& a, ga_vec3f& b, ga_vec3f& c) {
 	_normal = ga_vec3f_cross((b - a), (c - a)).normal();
 	_w = _normal.dot(a);
 }
 
-ga_csg_plane::ga_csg_plane(const ga_csg_plane& other)
-{
-	_normal = other._normal;
-	_w = other._w;
-}
-
 void ga_csg_plane::flip()
 {
 	_normal = -_normal;
@@ -43,11 +38,64 @@ ga_csg_plane ga_csg_plane::flipped()
 	return temp;
 }
 
+bool ga_csg_plane_table::key_t::operator==(const key_t& other) const
+{
+	return std::memcmp(_bits, other._bits, sizeof(_bits)) == 0;
+}
 
-ga_csg_plane ga_csg_plane::operator=(const ga_csg_plane& other)
+size_t ga_csg_plane_table::key_hash_t::operator()(const key_t& key) const
 {
-	ga_csg_plane temp;
-	temp._normal = other._normal;
-	temp._w = other._w;
-	return temp;
+	uint64_t hash = 14695981039346656037ull;
+	for (int i = 0; i < 4; i++) {
+		hash = (hash ^ key._bits[i]) * 1099511628211ull;
+	}
+	return (size_t)hash;
+}
+
+ga_csg_plane_table::key_t ga_csg_plane_table::get_key(const ga_csg_plane& plane)
+{
+	key_t key;
+	std::memcpy(&key._bits[0], &plane._normal, 3 * sizeof(float));
+	std::memcpy(&key._bits[3], &plane._w, sizeof(float));
+	return key;
+}
+
+uint32_t ga_csg_plane_table::add(const ga_csg_plane& plane)
+{
+	uint32_t index = (uint32_t)_planes.size();
+	auto result = _lookup.emplace(get_key(plane), index);
+	if (!result.second) return result.first->second;
+
+	ga_csg_plane flipped = plane;
+	flipped.flip();
+	_planes.push_back(plane);
+	_planes.push_back(flipped);
+	// Flipping negates every component, so the keys always differ: even a
+	// plane of all zeros flips to -0.0s, whose bits differ, and gets index + 1.
+	_lookup.emplace(get_key(flipped), index + 1);
+	return index;
+}
+
+uint32_t ga_csg_plane_table::find(const ga_csg_plane& plane) const
+{
+	auto it = _lookup.find(get_key(plane));
+	return it == _lookup.end() ? k_none : it->second;
+}
+
+void ga_csg_plane_table::transform(const ga_mat4f& mat, const ga_mat4f& normal_mat)
+{
+	_lookup.clear();
+	for (uint32_t i = 0; i < _planes.size(); i += 2) {
+		ga_csg_plane& plane = _planes[i];
+		// The point of the plane nearest the origin is still on it afterwards.
+		ga_vec3f point = mat.transform_point(plane._normal.scale_result(plane._w));
+		plane._normal = normal_mat.transform_vector(plane._normal);
+		plane._normal.normalize();
+		plane._w = plane._normal.dot(point);
+		_planes[i + 1] = plane.flipped();
+		// Planes that come out the same keep their own indices, and lookups
+		// find the first of them.
+		_lookup.emplace(get_key(_planes[i]), i);
+		_lookup.emplace(get_key(_planes[i + 1]), i + 1);
+	}
 }
@@ -14,6 +14,12 @@
 */
 
 #include "math/ga_vec3f.h"
+#include "math/ga_mat4f.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
 
 /*
 ** A plane data structure for CSG
@@ -23,18 +29,65 @@ class ga_csg_plane
 public:
 	ga_csg_plane();
 	ga_csg_plane(ga_vec3f& a, ga_vec3f& b, ga_vec3f& c);
-	ga_csg_plane(const ga_csg_plane& other);
-	~ga_csg_plane();
 
 	void flip();
 	ga_csg_plane flipped();
 
-	const float EPSILON = .00001f;
-
-	ga_csg_plane operator=(const ga_csg_plane& other);
+	// Points closer to a plane than this are on it.
+	static const float EPSILON;
 
 	ga_vec3f _normal;
 	float _w;
 };
 
-#endif
\ No newline at end of file
+/*
+** A table of distinct planes, shared by the polygon soups made from one
+** mesh, and referred to by 32-bit index.
+**
+** Adding a plane that is already in the table returns the existing index,
+** so polygons on the same plane have the same index and telling whether
+** two of them are coplanar is an integer compare. Planes are only equal if
+** they are bitwise identical; pieces split from a polygon keep its index.
+** Every plane is stored next to its flip: the flip of plane i is i ^ 1.
+*/
+class ga_csg_plane_table
+{
+public:
+	static const uint32_t k_none = 0xffffffffu;
+
+	int size() const { return (int)_planes.size(); }
+	const ga_csg_plane& get(uint32_t index) const { return _planes[index]; }
+
+	/*
+	** Find the plane in the table, adding it and its flip if it is not there.
+	*/
+	uint32_t add(const ga_csg_plane& plane);
+
+	/*
+	** Find the plane in the table, returning k_none if it is not there.
+	*/
+	uint32_t find(const ga_csg_plane& plane) const;
+
+	/*
+	** Transform every plane as ga_polygon_soup::transform transforms
+	** positions, given the matrix for normals as well. Indices stay the same.
+	*/
+	void transform(const ga_mat4f& mat, const ga_mat4f& normal_mat);
+
+private:
+	struct key_t
+	{
+		uint32_t _bits[4];
+		bool operator==(const key_t& other) const;
+	};
+	struct key_hash_t
+	{
+		size_t operator()(const key_t& key) const;
+	};
+	static key_t get_key(const ga_csg_plane& plane);
+
+	std::vector<ga_csg_plane> _planes;
+	std::unordered_map<key_t, uint32_t, key_hash_t> _lookup;
+};
+
+#endif
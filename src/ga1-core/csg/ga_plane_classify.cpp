@@ -0,0 +1,135 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+** Evan Wallace - CSG.js - https://github.com/evanw/csg.js
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_plane_classify.h"
+
+#include "framework/ga_compiler_defines.h"
+
+#if defined(GA_AVX2)
+#include <immintrin.h>
+#elif defined(GA_SSE2)
+#include <emmintrin.h>
+#endif
+
+static inline int classify_one(const ga_csg_plane& plane, const ga_vec3f& point, float* distance, uint8_t* side)
+{
+	float d = plane._normal.dot(point) - plane._w;
+	int type = (d < -plane.EPSILON) ? k_csg_back : (d > plane.EPSILON) ? k_csg_front : k_csg_coplanar;
+	*distance = d;
+	*side = (uint8_t)type;
+	return type;
+}
+
+int ga_csg_classify_points(
+	const ga_csg_plane& plane,
+	const ga_vec3f* points,
+	int count,
+	float* distances,
+	uint8_t* sides)
+{
+	int mask = 0;
+	int i = 0;
+
+	// ga_vec3f is three packed floats, so the points are read as a flat array.
+	const float* p = reinterpret_cast<const float*>(points);
+
+#if defined(GA_AVX2)
+	{
+		const __m256 nx = _mm256_set1_ps(plane._normal.x);
+		const __m256 ny = _mm256_set1_ps(plane._normal.y);
+		const __m256 nz = _mm256_set1_ps(plane._normal.z);
+		const __m256 w = _mm256_set1_ps(plane._w);
+		const __m256 eps = _mm256_set1_ps(plane.EPSILON);
+		const __m256 neg_eps = _mm256_set1_ps(-plane.EPSILON);
+		const __m256i stride = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+
+		for (; i + 8 <= count; i += 8)
+		{
+			const float* base = p + i * 3;
+			__m256 x = _mm256_i32gather_ps(base + 0, stride, 4);
+			__m256 y = _mm256_i32gather_ps(base + 1, stride, 4);
+			__m256 z = _mm256_i32gather_ps(base + 2, stride, 4);
+
+			__m256 d = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, x), _mm256_mul_ps(ny, y)), _mm256_mul_ps(nz, z)), w);
+			_mm256_storeu_ps(distances + i, d);
+
+			int front = _mm256_movemask_ps(_mm256_cmp_ps(d, eps, _CMP_GT_OQ));
+			int back = _mm256_movemask_ps(_mm256_cmp_ps(d, neg_eps, _CMP_LT_OQ));
+			for (int j = 0; j < 8; ++j)
+			{
+				sides[i + j] = (uint8_t)(((front >> j) & 1) | (((back >> j) & 1) << 1));
+			}
+			mask |= (front ? k_csg_front : 0) | (back ? k_csg_back : 0);
+		}
+	}
+#endif
+
+#if defined(GA_SSE2)
+	{
+		const __m128 nx = _mm_set1_ps(plane._normal.x);
+		const __m128 ny = _mm_set1_ps(plane._normal.y);
+		const __m128 nz = _mm_set1_ps(plane._normal.z);
+		const __m128 w = _mm_set1_ps(plane._w);
+		const __m128 eps = _mm_set1_ps(plane.EPSILON);
+		const __m128 neg_eps = _mm_set1_ps(-plane.EPSILON);
+		const __m128i one = _mm_set1_epi32(k_csg_front);
+		const __m128i two = _mm_set1_epi32(k_csg_back);
+
+		for (; i + 4 <= count; i += 4)
+		{
+			// Load four xyz triples and transpose them into x, y and z lanes.
+			const float* base = p + i * 3;
+			__m128 a = _mm_loadu_ps(base + 0); // x0 y0 z0 x1
+			__m128 b = _mm_loadu_ps(base + 4); // y1 z1 x2 y2
+			__m128 c = _mm_loadu_ps(base + 8); // z2 x3 y3 z3
+
+			__m128 x = _mm_shuffle_ps(
+				_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 0, 0)),
+				_mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)),
+				_MM_SHUFFLE(2, 0, 2, 0));
+			__m128 y = _mm_shuffle_ps(
+				_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)),
+				_mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)),
+				_MM_SHUFFLE(2, 0, 2, 0));
+			__m128 z = _mm_shuffle_ps(
+				_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)),
+				_mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)),
+				_MM_SHUFFLE(2, 0, 2, 0));
+
+			__m128 d = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, x), _mm_mul_ps(ny, y)), _mm_mul_ps(nz, z)), w);
+			_mm_storeu_ps(distances + i, d);
+
+			__m128 front = _mm_cmpgt_ps(d, eps);
+			__m128 back = _mm_cmplt_ps(d, neg_eps);
+
+			// Build the per-point side as 32-bit lanes and narrow them to bytes.
+			__m128i type = _mm_or_si128(
+				_mm_and_si128(_mm_castps_si128(front), one),
+				_mm_and_si128(_mm_castps_si128(back), two));
+			type = _mm_packs_epi32(type, type);
+			type = _mm_packus_epi16(type, type);
+			uint32_t packed = (uint32_t)_mm_cvtsi128_si32(type);
+			sides[i + 0] = (uint8_t)(packed);
+			sides[i + 1] = (uint8_t)(packed >> 8);
+			sides[i + 2] = (uint8_t)(packed >> 16);
+			sides[i + 3] = (uint8_t)(packed >> 24);
+
+			mask |= (_mm_movemask_ps(front) ? k_csg_front : 0) | (_mm_movemask_ps(back) ? k_csg_back : 0);
+		}
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		mask |= classify_one(plane, points[i], distances + i, sides + i);
+	}
+
+	return mask;
+}
@@ -0,0 +1,47 @@
+#ifndef GA_PLANE_CLASSIFY_H
+#define GA_PLANE_CLASSIFY_H
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+** Evan Wallace - CSG.js - https://github.com/evanw/csg.js
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "math/ga_vec3f.h"
+#include "ga_plane.h"
+
+#include <cstdint>
+
+/*
+** Which side of a plane a vertex or polygon lies on.
+** A polygon's class is the bitwise or of its vertex classes.
+*/
+enum ga_csg_side_t
+{
+	k_csg_coplanar = 0,
+	k_csg_front = 1,
+	k_csg_back = 2,
+	k_csg_spanning = 3,
+};
+
+/*
+** Classify a batch of points against a plane.
+**
+** Writes the signed distance of every point to distances and its side to
+** sides. Points within EPSILON of the plane are coplanar. Returns the
+** bitwise or of all sides, which is the class of a polygon made of the
+** points. Uses AVX2 or SSE2 when available and plain C++ otherwise; no
+** memory is allocated.
+*/
+int ga_csg_classify_points(
+	const ga_csg_plane& plane,
+	const ga_vec3f* points,
+	int count,
+	float* distances,
+	uint8_t* sides);
+
+#endif
@@ -0,0 +1,444 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+** Evan Wallace - CSG.js - https://github.com/evanw/csg.js
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_polygon_merge.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Positions closer than this on every axis are welded into one vertex.
+static const float k_weld_epsilon = 1e-5f;
+// Planes whose normals and offsets differ by no more than this are treated
+// as one.
+static const float k_plane_resolution = 1e-4f;
+// Sine of the largest angle a corner may bend the wrong way, or bend at all,
+// and still count as convex or straight.
+static const float k_angle_epsilon = 1e-5f;
+
+namespace
+{
+	// A cell of the welding grid, or with _w, a plane rounded to the plane resolution.
+	struct cell_key_t
+	{
+		int64_t _x, _y, _z, _w;
+		bool operator==(const cell_key_t& other) const
+		{
+			return _x == other._x && _y == other._y && _z == other._z && _w == other._w;
+		}
+	};
+
+	struct cell_hash_t
+	{
+		size_t operator()(const cell_key_t& key) const
+		{
+			uint64_t hash = uint64_t(key._x) * 0x9e3779b97f4a7c15ull;
+			hash ^= uint64_t(key._y) * 0xc2b2ae3d27d4eb4full + (hash << 6) + (hash >> 2);
+			hash ^= uint64_t(key._z) * 0x165667b19e3779f9ull + (hash << 6) + (hash >> 2);
+			hash ^= uint64_t(key._w) * 0x27d4eb2f165667c5ull + (hash << 6) + (hash >> 2);
+			return size_t(hash);
+		}
+	};
+
+	// A corner of a polygon: the welded position, and the normal it had.
+	struct corner_t
+	{
+		uint32_t _id;
+		ga_vec3f _normal;
+	};
+
+	typedef std::vector<corner_t> loop_t;
+}
+
+static inline cell_key_t cell_of(const ga_vec3f& pos, float size)
+{
+	return { int64_t(std::floor(pos.x / size)), int64_t(std::floor(pos.y / size)), int64_t(std::floor(pos.z / size)), 0 };
+}
+
+// Give every vertex of the soup the id of its welded position. Cells are as
+// wide as the tolerance, so a position only needs comparing with the ones
+// already in its own and the neighbouring cells.
+static void weld_positions(const ga_polygon_soup& src, std::vector<uint32_t>& ids, std::vector<ga_vec3f>& positions)
+{
+	std::unordered_map<cell_key_t, uint32_t, cell_hash_t> cells;
+	cells.reserve(src.get_vertex_count());
+	ids.resize(src.get_vertex_count());
+	for (int i = 0; i < src.get_vertex_count(); i++) {
+		const ga_vec3f& pos = src._positions[i];
+		cell_key_t cell = cell_of(pos, k_weld_epsilon);
+		uint32_t id = UINT32_MAX;
+		for (int dx = -1; dx <= 1 && id == UINT32_MAX; dx++) {
+			for (int dy = -1; dy <= 1 && id == UINT32_MAX; dy++) {
+				for (int dz = -1; dz <= 1 && id == UINT32_MAX; dz++) {
+					auto it = cells.find({ cell._x + dx, cell._y + dy, cell._z + dz, 0 });
+					if (it == cells.end()) continue;
+					const ga_vec3f& other = positions[it->second];
+					if (std::abs(other.x - pos.x) <= k_weld_epsilon &&
+						std::abs(other.y - pos.y) <= k_weld_epsilon &&
+						std::abs(other.z - pos.z) <= k_weld_epsilon) {
+						id = it->second;
+					}
+				}
+			}
+		}
+		if (id == UINT32_MAX) {
+			id = uint32_t(positions.size());
+			positions.push_back(pos);
+			cells.emplace(cell, id);
+		}
+		ids[i] = id;
+	}
+}
+
+static inline uint64_t edge_key(uint32_t a, uint32_t b)
+{
+	return (uint64_t(a) << 32) | b;
+}
+
+// Whether the corner b of the path a, b, c turns left about the normal, or
+// goes straight on.
+static inline bool is_convex_corner(const ga_vec3f& a, const ga_vec3f& b, const ga_vec3f& c, const ga_vec3f& normal)
+{
+	ga_vec3f ab = b - a;
+	ga_vec3f bc = c - b;
+	return ga_vec3f_cross(ab, bc).dot(normal) >= -k_angle_epsilon * std::sqrt(ab.mag2() * bc.mag2());
+}
+
+// Whether the corner b of the path a, b, c goes straight on.
+static inline bool is_straight_corner(const ga_vec3f& a, const ga_vec3f& b, const ga_vec3f& c)
+{
+	ga_vec3f ab = b - a;
+	ga_vec3f bc = c - b;
+	ga_vec3f cross = ga_vec3f_cross(ab, bc);
+	return ab.dot(bc) > 0.0f && cross.mag2() <= k_angle_epsilon * k_angle_epsilon * ab.mag2() * bc.mag2();
+}
+
+// Insert into each polygon the welded vertices of every other polygon, on
+// any plane, which lie inside one of its edges, sorted along the edge. Along
+// a crease the polygons on either side are cut by different planes, so the
+// vertices of one side must be inserted into the other as well for the two
+// to share whole edges. An inserted corner takes its normal from the edge.
+static void insert_t_junctions(std::vector<std::vector<loop_t>>& groups, const std::vector<ga_vec3f>& positions)
+{
+	// The vertices in use, sorted along each axis.
+	std::vector<bool> used(positions.size(), false);
+	std::vector<uint32_t> sorted[3];
+	for (const std::vector<loop_t>& loops : groups) {
+		for (const loop_t& loop : loops) {
+			for (const corner_t& corner : loop) {
+				if (used[corner._id]) continue;
+				used[corner._id] = true;
+				sorted[0].push_back(corner._id);
+			}
+		}
+	}
+	if (sorted[0].size() <= 3) return;
+
+	sorted[1] = sorted[0];
+	sorted[2] = sorted[0];
+	for (int axis = 0; axis < 3; axis++) {
+		std::sort(sorted[axis].begin(), sorted[axis].end(), [&](uint32_t a, uint32_t b) {
+			return positions[a].axes[axis] < positions[b].axes[axis];
+		});
+	}
+
+	struct inserted_t
+	{
+		float _t;
+		corner_t _corner;
+	};
+	std::vector<inserted_t> inserted;
+	for (std::vector<loop_t>& loops : groups) {
+		for (loop_t& loop : loops) {
+			loop_t result;
+			for (size_t i = 0; i < loop.size(); i++) {
+				const corner_t& a = loop[i];
+				const corner_t& b = loop[(i + 1) % loop.size()];
+				result.push_back(a);
+
+				const ga_vec3f& pa = positions[a._id];
+				const ga_vec3f& pb = positions[b._id];
+				ga_vec3f ab = pb - pa;
+				float length2 = ab.mag2();
+				if (length2 <= k_weld_epsilon * k_weld_epsilon) continue;
+
+				// Search along whichever axis the edge spans most of.
+				int axis = 0;
+				for (int k = 1; k < 3; k++) {
+					if (std::abs(ab.axes[k]) > std::abs(ab.axes[axis])) axis = k;
+				}
+				float lo = std::min(pa.axes[axis], pb.axes[axis]) - k_weld_epsilon;
+				float hi = std::max(pa.axes[axis], pb.axes[axis]) + k_weld_epsilon;
+				auto first = std::lower_bound(sorted[axis].begin(), sorted[axis].end(), lo,
+					[&](uint32_t id, float value) { return positions[id].axes[axis] < value; });
+
+				// The edge's bounds on the other two axes reject most of the range.
+				int u = (axis + 1) % 3;
+				int v = (axis + 2) % 3;
+				float u_lo = std::min(pa.axes[u], pb.axes[u]) - k_weld_epsilon;
+				float u_hi = std::max(pa.axes[u], pb.axes[u]) + k_weld_epsilon;
+				float v_lo = std::min(pa.axes[v], pb.axes[v]) - k_weld_epsilon;
+				float v_hi = std::max(pa.axes[v], pb.axes[v]) + k_weld_epsilon;
+
+				inserted.clear();
+				for (auto it = first; it != sorted[axis].end() && positions[*it].axes[axis] <= hi; ++it) {
+					const ga_vec3f& pos = positions[*it];
+					if (pos.axes[u] < u_lo || pos.axes[u] > u_hi || pos.axes[v] < v_lo || pos.axes[v] > v_hi) continue;
+					if (*it == a._id || *it == b._id) continue;
+					ga_vec3f av = pos - pa;
+					float t = av.dot(ab) / length2;
+					if (t <= 0.0f || t >= 1.0f) continue;
+					ga_vec3f offset = av - ab.scale_result(t);
+					if (offset.mag2() > k_weld_epsilon * k_weld_epsilon) continue;
+					inserted.push_back({ t, { *it, ga_vec3f_lerp(a._normal, b._normal, t) } });
+				}
+				std::sort(inserted.begin(), inserted.end(),
+					[](const inserted_t& x, const inserted_t& y) { return x._t < y._t; });
+				for (const inserted_t& vertex : inserted) result.push_back(vertex._corner);
+			}
+			loop = std::move(result);
+		}
+	}
+}
+
+// Remove back-and-forth spikes, such as the ones left where two polygons
+// that shared a chain of edges were joined across only one of them.
+static void remove_spikes(loop_t& loop)
+{
+	bool removed = true;
+	while (removed && loop.size() >= 3) {
+		removed = false;
+		for (size_t i = 0; i < loop.size() && loop.size() >= 3; i++) {
+			size_t prev = (i + loop.size() - 1) % loop.size();
+			size_t next = (i + 1) % loop.size();
+			if (loop[prev]._id != loop[next]._id) continue;
+			// Drop the tip and one of the two copies of its base.
+			size_t first = std::min(i, next);
+			size_t second = std::max(i, next);
+			loop.erase(loop.begin() + second);
+			loop.erase(loop.begin() + first);
+			removed = true;
+			break;
+		}
+	}
+}
+
+// Join the polygons p and q across the edge p[i], p[i + 1], which q has the
+// other way round at q[j], q[j + 1]. Fails if the result is not convex.
+static bool join_loops(const loop_t& p, size_t i, const loop_t& q, size_t j,
+	const std::vector<ga_vec3f>& positions, const ga_vec3f& normal, loop_t& joined)
+{
+	joined.clear();
+	for (size_t k = 1; k <= p.size(); k++) joined.push_back(p[(i + k) % p.size()]);
+	for (size_t k = 2; k < q.size(); k++) joined.push_back(q[(j + k) % q.size()]);
+	remove_spikes(joined);
+	if (joined.size() < 3) return false;
+
+	for (size_t k = 0; k < joined.size(); k++) {
+		const ga_vec3f& a = positions[joined[(k + joined.size() - 1) % joined.size()]._id];
+		const ga_vec3f& b = positions[joined[k]._id];
+		const ga_vec3f& c = positions[joined[(k + 1) % joined.size()]._id];
+		if (!is_convex_corner(a, b, c, normal)) return false;
+	}
+
+	// A polygon passing through the same vertex twice would not be simple.
+	std::vector<uint32_t> ids(joined.size());
+	for (size_t k = 0; k < joined.size(); k++) ids[k] = joined[k]._id;
+	std::sort(ids.begin(), ids.end());
+	return std::adjacent_find(ids.begin(), ids.end()) == ids.end();
+}
+
+// Merge neighbouring polygons of one plane for as long as they stay convex.
+static void merge_loops(std::vector<loop_t>& loops, const std::vector<ga_vec3f>& positions, const ga_vec3f& normal)
+{
+	std::unordered_map<uint64_t, int> edges;
+	for (int p = 0; p < (int)loops.size(); p++) {
+		const loop_t& loop = loops[p];
+		for (size_t i = 0; i < loop.size(); i++) {
+			edges[edge_key(loop[i]._id, loop[(i + 1) % loop.size()]._id)] = p;
+		}
+	}
+
+	auto remove_edges = [&edges](const loop_t& loop, int owner) {
+		for (size_t i = 0; i < loop.size(); i++) {
+			auto it = edges.find(edge_key(loop[i]._id, loop[(i + 1) % loop.size()]._id));
+			if (it != edges.end() && it->second == owner) edges.erase(it);
+		}
+	};
+
+	std::vector<bool> alive(loops.size(), true);
+	std::vector<int> queue;
+	for (int p = (int)loops.size() - 1; p >= 0; p--) queue.push_back(p);
+	loop_t joined;
+	while (!queue.empty()) {
+		int p = queue.back();
+		queue.pop_back();
+		if (!alive[p]) continue;
+
+		loop_t& loop = loops[p];
+		for (size_t i = 0; i < loop.size(); i++) {
+			uint32_t a = loop[i]._id;
+			uint32_t b = loop[(i + 1) % loop.size()]._id;
+			auto it = edges.find(edge_key(b, a));
+			if (it == edges.end() || it->second == p || !alive[it->second]) continue;
+
+			int q = it->second;
+			const loop_t& other = loops[q];
+			size_t j = 0;
+			while (j < other.size() && !(other[j]._id == b && other[(j + 1) % other.size()]._id == a)) j++;
+			if (j == other.size()) continue;
+			if (!join_loops(loop, i, other, j, positions, normal, joined)) continue;
+
+			remove_edges(loop, p);
+			remove_edges(other, q);
+			alive[q] = false;
+			loops[q].clear();
+			loop = joined;
+			for (size_t k = 0; k < loop.size(); k++) {
+				edges[edge_key(loop[k]._id, loop[(k + 1) % loop.size()]._id)] = p;
+			}
+			// Try the grown polygon against its new neighbours.
+			queue.push_back(p);
+			break;
+		}
+	}
+
+	size_t count = 0;
+	for (size_t p = 0; p < loops.size(); p++) {
+		if (!alive[p]) continue;
+		if (count != p) loops[count] = std::move(loops[p]);
+		count++;
+	}
+	loops.resize(count);
+}
+
+void merge_coplanar_polygons(const ga_polygon_soup& src, ga_polygon_soup& out)
+{
+	std::vector<uint32_t> vertex_ids;
+	std::vector<ga_vec3f> positions;
+	weld_positions(src, vertex_ids, positions);
+
+	// Group the polygons by plane, in order of each plane's first polygon.
+	// Polygons that share an entry of the plane table are on the same plane.
+	// Entries that differ by no more than the plane resolution, such as the
+	// same face of two operands placed by different transforms, are joined
+	// too. Planes are bucketed in cells twice the resolution wide, so such a
+	// pair is in the same cell or, on each axis, the neighbour on the side of
+	// the cell's middle the plane is on.
+	const float plane_cell = 2.0f * k_plane_resolution;
+	std::unordered_map<cell_key_t, int, cell_hash_t> plane_cells;
+	std::unordered_map<uint32_t, int> plane_groups;
+	std::vector<std::vector<int>> groups;
+	for (int poly = 0; poly < src.size(); poly++) {
+		uint32_t index = src.get_plane_index(poly);
+		auto found = plane_groups.find(index);
+		if (found == plane_groups.end()) {
+			const ga_csg_plane& plane = src.get_plane(poly);
+			float values[4] = { plane._normal.x, plane._normal.y, plane._normal.z, plane._w };
+			int64_t cell[4];
+			int64_t side[4];
+			for (int k = 0; k < 4; k++) {
+				float scaled = values[k] / plane_cell;
+				cell[k] = int64_t(std::floor(scaled));
+				side[k] = scaled - std::floor(scaled) < 0.5f ? -1 : 1;
+			}
+			int group = -1;
+			for (int i = 0; i < 16 && group < 0; i++) {
+				cell_key_t key = {
+					cell[0] + ((i & 1) ? side[0] : 0),
+					cell[1] + ((i & 2) ? side[1] : 0),
+					cell[2] + ((i & 4) ? side[2] : 0),
+					cell[3] + ((i & 8) ? side[3] : 0) };
+				auto it = plane_cells.find(key);
+				if (it == plane_cells.end()) continue;
+				const ga_csg_plane& other = src.get_plane(groups[it->second][0]);
+				if (std::abs(other._normal.x - plane._normal.x) <= k_plane_resolution &&
+					std::abs(other._normal.y - plane._normal.y) <= k_plane_resolution &&
+					std::abs(other._normal.z - plane._normal.z) <= k_plane_resolution &&
+					std::abs(other._w - plane._w) <= k_plane_resolution) {
+					group = it->second;
+				}
+			}
+			if (group < 0) {
+				group = (int)groups.size();
+				groups.emplace_back();
+				plane_cells.emplace(cell_key_t{ cell[0], cell[1], cell[2], cell[3] }, group);
+			}
+			found = plane_groups.emplace(index, group).first;
+		}
+		groups[found->second].push_back(poly);
+	}
+
+	std::vector<std::vector<loop_t>> group_loops(groups.size());
+	for (int group = 0; group < (int)groups.size(); group++) {
+		std::vector<loop_t>& loops = group_loops[group];
+		for (int poly : groups[group]) {
+			loop_t loop;
+			const ga_vec3f* normals = src.get_normals(poly);
+			uint32_t offset = src._offsets[poly];
+			for (int i = 0; i < src.get_count(poly); i++) {
+				uint32_t id = vertex_ids[offset + i];
+				if (!loop.empty() && loop.back()._id == id) continue;
+				loop.push_back({ id, normals[i] });
+			}
+			while (loop.size() > 1 && loop.back()._id == loop.front()._id) loop.pop_back();
+			// Polygons welded down to a line or a point have no area.
+			if (loop.size() >= 3) loops.push_back(std::move(loop));
+		}
+	}
+
+	insert_t_junctions(group_loops, positions);
+
+	struct merged_t
+	{
+		loop_t _loop;
+		int _poly;
+	};
+	std::vector<merged_t> merged;
+	for (int group = 0; group < (int)groups.size(); group++) {
+		std::vector<loop_t>& loops = group_loops[group];
+		int first_poly = groups[group][0];
+		if (loops.size() > 1) merge_loops(loops, positions, src.get_plane(first_poly)._normal);
+		for (loop_t& loop : loops) merged.push_back({ std::move(loop), first_poly });
+	}
+
+	// Vertices in the middle of a straight edge can go, unless another
+	// polygon, on this plane or another, still has a corner there.
+	std::vector<uint32_t> uses(positions.size(), 0);
+	for (const merged_t& polygon : merged) {
+		for (const corner_t& corner : polygon._loop) uses[corner._id]++;
+	}
+
+	out.clear();
+	out.reserve((int)merged.size(), src.get_vertex_count());
+	for (merged_t& polygon : merged) {
+		loop_t& loop = polygon._loop;
+		bool removed = true;
+		while (removed && loop.size() > 3) {
+			removed = false;
+			for (size_t i = 0; i < loop.size(); i++) {
+				if (uses[loop[i]._id] != 1) continue;
+				const ga_vec3f& a = positions[loop[(i + loop.size() - 1) % loop.size()]._id];
+				const ga_vec3f& b = positions[loop[i]._id];
+				const ga_vec3f& c = positions[loop[(i + 1) % loop.size()]._id];
+				if (!is_straight_corner(a, b, c)) continue;
+				loop.erase(loop.begin() + i);
+				removed = true;
+				break;
+			}
+		}
+
+		out.begin_polygon();
+		for (const corner_t& corner : loop) out.push_vertex(positions[corner._id], corner._normal);
+		out.end_polygon(out.add_plane(src.get_plane(polygon._poly)));
+	}
+}
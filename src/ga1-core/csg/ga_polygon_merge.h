@@ -0,0 +1,31 @@
+#ifndef GA_POLYGON_MERGE_H
+#define GA_POLYGON_MERGE_H
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+** Evan Wallace - CSG.js - https://github.com/evanw/csg.js
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_polygon_soup.h"
+
+/*
+** Cleans up the polygons output by a CSG operation, whose faces are left cut
+** into many fragments by the planes of the other solid.
+**
+** Vertices closer together than a small tolerance are welded, and polygons
+** are grouped by plane. Vertices that lie on another polygon's edge, on the
+** same plane or across a crease, are inserted into it, so that neighbouring
+** fragments share whole edges instead of meeting at T-junctions. Within each
+** plane, neighbours are then merged for as long as the result stays convex. Vertices in the middle of a
+** straight edge are then dropped, unless another polygon still uses them.
+**
+** The surface is unchanged; only how it is divided into polygons is.
+*/
+void merge_coplanar_polygons(const ga_polygon_soup& src, ga_polygon_soup& out);
+
+#endif
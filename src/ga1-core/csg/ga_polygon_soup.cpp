@@ -0,0 +1,540 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+** Evan Wallace - CSG.js - https://github.com/evanw/csg.js
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_polygon_soup.h"
+#include "ga_plane_classify.h"
+
+#include "framework/ga_compiler_defines.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#if defined(GA_SSE2)
+#include <emmintrin.h>
+#endif
+
+ga_polygon_soup::ga_polygon_soup(const std::vector<ga_polygon>& polys)
+{
+	int vertex_count = 0;
+	for (int i = 0; i < polys.size(); i++) {
+		vertex_count += (int)polys[i]._vertices.size();
+	}
+	reserve((int)polys.size(), vertex_count);
+	for (int i = 0; i < polys.size(); i++) {
+		append(polys[i]);
+	}
+}
+
+void ga_polygon_soup::clear()
+{
+	_positions.clear();
+	_normals.clear();
+	_offsets.clear();
+	_counts.clear();
+	_plane_indices.clear();
+	_planes.reset();
+}
+
+void ga_polygon_soup::reserve(int poly_count, int vertex_count)
+{
+	_positions.reserve(vertex_count);
+	_normals.reserve(vertex_count);
+	_offsets.reserve(poly_count);
+	_counts.reserve(poly_count);
+	_plane_indices.reserve(poly_count);
+}
+
+ga_csg_plane_table& ga_polygon_soup::get_unique_planes()
+{
+	if (!_planes) {
+		_planes = std::make_shared<ga_csg_plane_table>();
+	}
+	else if (_planes.use_count() > 1) {
+		_planes = std::make_shared<ga_csg_plane_table>(*_planes);
+	}
+	return *_planes;
+}
+
+uint32_t ga_polygon_soup::add_plane(const ga_csg_plane& plane)
+{
+	// Most planes added are already in the table, and finding them needs no copy.
+	if (_planes) {
+		uint32_t index = _planes->find(plane);
+		if (index != ga_csg_plane_table::k_none) return index;
+	}
+	return get_unique_planes().add(plane);
+}
+
+uint32_t ga_polygon_soup::import_plane(const ga_polygon_soup& other, int poly)
+{
+	uint32_t index = other._plane_indices[poly];
+	if (_planes == other._planes) return index;
+	if (_plane_indices.empty()) {
+		_planes = other._planes;
+		return index;
+	}
+	return add_plane(other._planes->get(index));
+}
+
+void ga_polygon_soup::begin_polygon()
+{
+	_offsets.push_back((uint32_t)_positions.size());
+}
+
+void ga_polygon_soup::push_vertex(const ga_vec3f& pos, const ga_vec3f& normal)
+{
+	_positions.push_back(pos);
+	_normals.push_back(normal);
+}
+
+bool ga_polygon_soup::end_polygon(uint32_t plane_index)
+{
+	uint32_t offset = _offsets.back();
+	uint32_t count = (uint32_t)_positions.size() - offset;
+	if (count < 3) {
+		_positions.resize(offset);
+		_normals.resize(offset);
+		_offsets.pop_back();
+		return false;
+	}
+	_counts.push_back(count);
+	_plane_indices.push_back(plane_index);
+	return true;
+}
+
+void ga_polygon_soup::append(const ga_polygon_soup& other, int poly)
+{
+	uint32_t offset = other._offsets[poly];
+	uint32_t count = other._counts[poly];
+	_offsets.push_back((uint32_t)_positions.size());
+	_counts.push_back(count);
+	_plane_indices.push_back(import_plane(other, poly));
+	_positions.insert(_positions.end(), other._positions.begin() + offset, other._positions.begin() + offset + count);
+	_normals.insert(_normals.end(), other._normals.begin() + offset, other._normals.begin() + offset + count);
+}
+
+void ga_polygon_soup::append(const ga_polygon_soup& other)
+{
+	if (other.empty()) return;
+	uint32_t base = (uint32_t)_positions.size();
+	reserve(size() + other.size(), get_vertex_count() + other.get_vertex_count());
+
+	_positions.insert(_positions.end(), other._positions.begin(), other._positions.end());
+	_normals.insert(_normals.end(), other._normals.begin(), other._normals.end());
+	_counts.insert(_counts.end(), other._counts.begin(), other._counts.end());
+	for (int i = 0; i < other.size(); i++) {
+		_offsets.push_back(base + other._offsets[i]);
+	}
+
+	if (_plane_indices.empty()) _planes = other._planes;
+	if (_planes == other._planes) {
+		_plane_indices.insert(_plane_indices.end(), other._plane_indices.begin(), other._plane_indices.end());
+		return;
+	}
+
+	// Look up each of the other table's planes once, however many polygons use it.
+	const uint32_t none = ga_csg_plane_table::k_none;
+	std::vector<uint32_t> remap(other._planes->size(), none);
+	for (int i = 0; i < other.size(); i++) {
+		uint32_t& index = remap[other._plane_indices[i]];
+		if (index == ga_csg_plane_table::k_none) index = add_plane(other.get_plane(i));
+		_plane_indices.push_back(index);
+	}
+}
+
+void ga_polygon_soup::append(const ga_polygon& poly)
+{
+	begin_polygon();
+	for (int i = 0; i < poly._vertices.size(); i++) {
+		push_vertex(poly._vertices[i]._pos, poly._vertices[i]._normal);
+	}
+	end_polygon(add_plane(poly._plane));
+}
+
+void ga_polygon_soup::flip()
+{
+	for (int i = 0; i < size(); i++) {
+		std::reverse(_positions.begin() + _offsets[i], _positions.begin() + _offsets[i] + _counts[i]);
+		std::reverse(_normals.begin() + _offsets[i], _normals.begin() + _offsets[i] + _counts[i]);
+	}
+	for (int i = 0; i < _normals.size(); i++) {
+		_normals[i] = -_normals[i];
+	}
+	// Every plane is stored next to its flip, so the table is left alone.
+	for (int i = 0; i < _plane_indices.size(); i++) {
+		_plane_indices[i] ^= 1;
+	}
+}
+
+// Transform points (or directions, without the translation row) four at a
+// time. Each group of four xyz triples is transposed into x, y and z lanes,
+// transformed, and transposed back.
+static void transform_points(const ga_mat4f& mat, bool translate, ga_vec3f* points, int count)
+{
+	int i = 0;
+	float tx = translate ? mat.data[3][0] : 0.0f;
+	float ty = translate ? mat.data[3][1] : 0.0f;
+	float tz = translate ? mat.data[3][2] : 0.0f;
+
+#if defined(GA_SSE2)
+	{
+		const __m128 m00 = _mm_set1_ps(mat.data[0][0]), m01 = _mm_set1_ps(mat.data[0][1]), m02 = _mm_set1_ps(mat.data[0][2]);
+		const __m128 m10 = _mm_set1_ps(mat.data[1][0]), m11 = _mm_set1_ps(mat.data[1][1]), m12 = _mm_set1_ps(mat.data[1][2]);
+		const __m128 m20 = _mm_set1_ps(mat.data[2][0]), m21 = _mm_set1_ps(mat.data[2][1]), m22 = _mm_set1_ps(mat.data[2][2]);
+		const __m128 m30 = _mm_set1_ps(tx), m31 = _mm_set1_ps(ty), m32 = _mm_set1_ps(tz);
+
+		float* p = reinterpret_cast<float*>(points);
+		for (; i + 4 <= count; i += 4)
+		{
+			float* base = p + i * 3;
+			__m128 a = _mm_loadu_ps(base + 0); // x0 y0 z0 x1
+			__m128 b = _mm_loadu_ps(base + 4); // y1 z1 x2 y2
+			__m128 c = _mm_loadu_ps(base + 8); // z2 x3 y3 z3
+
+			__m128 x = _mm_shuffle_ps(
+				_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 0, 0)),
+				_mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)),
+				_MM_SHUFFLE(2, 0, 2, 0));
+			__m128 y = _mm_shuffle_ps(
+				_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)),
+				_mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)),
+				_MM_SHUFFLE(2, 0, 2, 0));
+			__m128 z = _mm_shuffle_ps(
+				_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)),
+				_mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)),
+				_MM_SHUFFLE(2, 0, 2, 0));
+
+			__m128 ox = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m00), _mm_mul_ps(y, m10)), _mm_add_ps(_mm_mul_ps(z, m20), m30));
+			__m128 oy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m01), _mm_mul_ps(y, m11)), _mm_add_ps(_mm_mul_ps(z, m21), m31));
+			__m128 oz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m02), _mm_mul_ps(y, m12)), _mm_add_ps(_mm_mul_ps(z, m22), m32));
+
+			a = _mm_shuffle_ps(_mm_unpacklo_ps(ox, oy), _mm_shuffle_ps(oz, ox, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 1, 0));
+			b = _mm_shuffle_ps(_mm_shuffle_ps(oy, oz, _MM_SHUFFLE(1, 1, 1, 1)), _mm_shuffle_ps(ox, oy, _MM_SHUFFLE(2, 2, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0));
+			c = _mm_shuffle_ps(_mm_shuffle_ps(oz, ox, _MM_SHUFFLE(3, 3, 2, 2)), _mm_shuffle_ps(oy, oz, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+			_mm_storeu_ps(base + 0, a);
+			_mm_storeu_ps(base + 4, b);
+			_mm_storeu_ps(base + 8, c);
+		}
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		ga_vec3f in = points[i];
+		points[i].x = in.x * mat.data[0][0] + in.y * mat.data[1][0] + in.z * mat.data[2][0] + tx;
+		points[i].y = in.x * mat.data[0][1] + in.y * mat.data[1][1] + in.z * mat.data[2][1] + ty;
+		points[i].z = in.x * mat.data[0][2] + in.y * mat.data[1][2] + in.z * mat.data[2][2] + tz;
+	}
+}
+
+static void normalize_all(ga_vec3f* vectors, int count)
+{
+	for (int i = 0; i < count; i++) {
+		float length = vectors[i].mag();
+		if (length > 0.0f) vectors[i].scale(1.0f / length);
+	}
+}
+
+void ga_polygon_soup::transform(const ga_mat4f& mat)
+{
+	transform_points(mat, true, _positions.data(), (int)_positions.size());
+
+	// Normals transform by the inverse transpose, which keeps them
+	// perpendicular to the surface under non-uniform scales.
+	ga_mat4f normal_mat = mat.inverse();
+	normal_mat.transpose();
+	transform_points(normal_mat, false, _normals.data(), (int)_normals.size());
+	normalize_all(_normals.data(), (int)_normals.size());
+
+	if (_planes) get_unique_planes().transform(mat, normal_mat);
+}
+
+static void grow_bounds(const ga_vec3f* positions, int count, ga_vec3f& min, ga_vec3f& max)
+{
+	for (int i = 0; i < count; i++) {
+		for (int axis = 0; axis < 3; axis++) {
+			min.axes[axis] = std::min(min.axes[axis], positions[i].axes[axis]);
+			max.axes[axis] = std::max(max.axes[axis], positions[i].axes[axis]);
+		}
+	}
+}
+
+bool ga_polygon_soup::get_bounds(ga_vec3f& min, ga_vec3f& max) const
+{
+	if (_positions.empty()) return false;
+	min = max = _positions[0];
+	grow_bounds(_positions.data(), (int)_positions.size(), min, max);
+	return true;
+}
+
+void ga_polygon_soup::get_bounds(int poly, ga_vec3f& min, ga_vec3f& max) const
+{
+	const ga_vec3f* positions = get_positions(poly);
+	min = max = positions[0];
+	grow_bounds(positions, get_count(poly), min, max);
+}
+
+uint64_t ga_polygon_soup::get_hash() const
+{
+	// Offsets follow from the counts; planes are derived from the positions.
+	uint64_t hash = ga_csg_hash(_counts.data(), _counts.size() * sizeof(uint32_t));
+	hash = ga_csg_hash(_positions.data(), _positions.size() * sizeof(ga_vec3f), hash);
+	return ga_csg_hash(_normals.data(), _normals.size() * sizeof(ga_vec3f), hash);
+}
+
+ga_polygon ga_polygon_soup::get_polygon(int poly) const
+{
+	std::vector<ga_csg_vertex> verts;
+	verts.reserve(_counts[poly]);
+	for (uint32_t i = _offsets[poly]; i < _offsets[poly] + _counts[poly]; i++) {
+		ga_vec3f pos = _positions[i];
+		ga_vec3f normal = _normals[i];
+		verts.push_back(ga_csg_vertex(pos, normal));
+	}
+	ga_polygon temp = ga_polygon(verts);
+	temp._plane = get_plane(poly);
+	return temp;
+}
+
+void ga_polygon_soup::get_polygons(std::vector<ga_polygon>& polys) const
+{
+	polys.reserve(polys.size() + size());
+	for (int i = 0; i < size(); i++) {
+		polys.push_back(get_polygon(i));
+	}
+}
+
+uint64_t ga_csg_hash(const void* data, size_t size, uint64_t hash)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+// Sort one polygon into the output lists, given the side and signed distance
+// of each of its vertices and the class of the polygon as a whole.
+static void split_classified(const ga_csg_plane& plane,
+					const ga_polygon_soup& src,
+					int poly,
+					const float* distances,
+					const uint8_t* sides,
+					int polygon_type,
+					ga_polygon_soup& coplanar_front,
+					ga_polygon_soup& coplanar_back,
+					ga_polygon_soup& front,
+					ga_polygon_soup& back)
+{
+	const ga_vec3f* positions = src.get_positions(poly);
+	const ga_vec3f* normals = src.get_normals(poly);
+	int count = src.get_count(poly);
+
+	// Put the polygon in the correct list, splitting it when necessary.
+	switch (polygon_type) {
+	case k_csg_coplanar:
+		(plane._normal.dot(src.get_plane(poly)._normal) > 0 ? coplanar_front : coplanar_back).append(src, poly);
+		break;
+	case k_csg_front:
+		front.append(src, poly);
+		break;
+	case k_csg_back:
+		back.append(src, poly);
+		break;
+	case k_csg_spanning:
+		// Emit the front piece, then the back piece. Building them one after
+		// the other keeps each piece contiguous even if the outputs alias.
+		for (int side = k_csg_front; side <= k_csg_back; side++) {
+			ga_polygon_soup& out = (side == k_csg_front) ? front : back;
+			out.begin_polygon();
+			for (int i = 0; i < count; i++) {
+				int j = (i + 1) % count;
+				int ti = sides[i];
+				int tj = sides[j];
+				if (ti != (side ^ k_csg_spanning)) out.push_vertex(positions[i], normals[i]);
+				if ((ti | tj) == k_csg_spanning) {
+					float t = distances[i] / (distances[i] - distances[j]);
+					out.push_vertex(ga_vec3f_lerp(positions[i], positions[j], t), ga_vec3f_lerp(normals[i], normals[j], t));
+				}
+			}
+			out.end_polygon(out.import_plane(src, poly));
+		}
+		break;
+	}
+}
+
+// Vertices classified per batch; polygons with more vertices than this fall
+// back to a per-thread scratch buffer.
+static const int k_classify_batch = 256;
+
+void split_polygon(const ga_csg_plane& plane,
+					const ga_polygon_soup& src,
+					int poly,
+					ga_polygon_soup& coplanar_front,
+					ga_polygon_soup& coplanar_back,
+					ga_polygon_soup& front,
+					ga_polygon_soup& back)
+{
+	float distances_local[k_classify_batch];
+	uint8_t sides_local[k_classify_batch];
+	float* distances = distances_local;
+	uint8_t* sides = sides_local;
+
+	int count = src.get_count(poly);
+	if (count > k_classify_batch) {
+		static thread_local std::vector<float> distances_scratch;
+		static thread_local std::vector<uint8_t> sides_scratch;
+		distances_scratch.resize(count);
+		sides_scratch.resize(count);
+		distances = distances_scratch.data();
+		sides = sides_scratch.data();
+	}
+
+	int polygon_type = ga_csg_classify_points(plane, src.get_positions(poly), count, distances, sides);
+	split_classified(plane, src, poly, distances, sides, polygon_type, coplanar_front, coplanar_back, front, back);
+}
+
+void split_polygons(const ga_csg_plane& plane,
+					const ga_polygon_soup& src,
+					ga_polygon_soup& coplanar_front,
+					ga_polygon_soup& coplanar_back,
+					ga_polygon_soup& front,
+					ga_polygon_soup& back)
+{
+	split_polygons(plane, src, 0, src.size(), coplanar_front, coplanar_back, front, back);
+}
+
+// Splits the polygons from first up to end. If plane is the source soup's
+// plane plane_index, polygons with that index or its flip's are coplanar
+// without being classified; otherwise plane_index is k_none.
+static void split_range(const ga_csg_plane& plane,
+					uint32_t plane_index,
+					const ga_polygon_soup& src,
+					int first,
+					int end,
+					ga_polygon_soup& coplanar_front,
+					ga_polygon_soup& coplanar_back,
+					ga_polygon_soup& front,
+					ga_polygon_soup& back)
+{
+	float distances[k_classify_batch];
+	uint8_t sides[k_classify_batch];
+
+	// The flip of plane i is i ^ 1, so this matches both.
+	auto on_plane = [&](int poly) {
+		return plane_index != ga_csg_plane_table::k_none && (src._plane_indices[poly] ^ plane_index) <= 1;
+	};
+
+	int poly = first;
+	while (poly < end) {
+		if (on_plane(poly)) {
+			(src._plane_indices[poly] == plane_index ? coplanar_front : coplanar_back).append(src, poly);
+			poly++;
+			continue;
+		}
+
+		// Gather the run of polygons whose vertices fit in one batch. Polygons
+		// are stored back to back, so the run is one contiguous vertex range.
+		uint32_t begin = src._offsets[poly];
+		int last = poly;
+		while (last < end && !on_plane(last) && src._offsets[last] + src._counts[last] - begin <= k_classify_batch) {
+			last++;
+		}
+		if (last == poly) {
+			split_polygon(plane, src, poly, coplanar_front, coplanar_back, front, back);
+			poly++;
+			continue;
+		}
+
+		uint32_t batch_end = src._offsets[last - 1] + src._counts[last - 1];
+		ga_csg_classify_points(plane, src.get_positions(poly), batch_end - begin, distances, sides);
+
+		for (; poly < last; poly++) {
+			uint32_t offset = src._offsets[poly] - begin;
+			int polygon_type = 0;
+			for (uint32_t i = offset; i < offset + src._counts[poly]; i++) {
+				polygon_type |= sides[i];
+			}
+			split_classified(plane, src, poly, distances + offset, sides + offset, polygon_type,
+				coplanar_front, coplanar_back, front, back);
+		}
+	}
+}
+
+void split_polygons(const ga_csg_plane& plane,
+					const ga_polygon_soup& src,
+					int first,
+					int end,
+					ga_polygon_soup& coplanar_front,
+					ga_polygon_soup& coplanar_back,
+					ga_polygon_soup& front,
+					ga_polygon_soup& back)
+{
+	split_range(plane, ga_csg_plane_table::k_none, src, first, end, coplanar_front, coplanar_back, front, back);
+}
+
+void split_polygons(uint32_t plane_index,
+					const ga_polygon_soup& src,
+					int first,
+					int end,
+					ga_polygon_soup& coplanar_front,
+					ga_polygon_soup& coplanar_back,
+					ga_polygon_soup& front,
+					ga_polygon_soup& back)
+{
+	const ga_csg_plane& plane = src.get_plane_table()->get(plane_index);
+	split_range(plane, plane_index, src, first, end, coplanar_front, coplanar_back, front, back);
+}
+
+bool gather_planes(const ga_polygon_soup& src, int max_planes, std::vector<ga_csg_plane>& planes)
+{
+	const float k_epsilon = 1e-5f;
+
+	planes.clear();
+	for (int i = 0; i < src.size(); i++) {
+		const ga_csg_plane& plane = src.get_plane(i);
+		bool found = false;
+		for (const ga_csg_plane& other : planes) {
+			if (std::abs(other._w - plane._w) < k_epsilon && other._normal.dot(plane._normal) > 1.0f - k_epsilon) {
+				found = true;
+				break;
+			}
+		}
+		if (found) continue;
+		if (int(planes.size()) == max_planes) return false;
+		planes.push_back(plane);
+	}
+	return true;
+}
+
+void clip_polygons_to_convex(const std::vector<ga_csg_plane>& planes,
+							 const ga_polygon_soup& src,
+							 bool inverted,
+							 ga_polygon_soup& out)
+{
+	// The tree of a convex solid is a chain of its faces, with nothing in
+	// front of any of them. Pieces in front of a face are outside the solid;
+	// those behind it move on to the next face, and are inside once behind all.
+	ga_polygon_soup remaining;
+	ga_polygon_soup behind;
+	ga_polygon_soup discarded;
+	const ga_polygon_soup* current = &src;
+	for (const ga_csg_plane& plane : planes) {
+		ga_polygon_soup& outside = inverted ? discarded : out;
+		behind.clear();
+		discarded.clear();
+		split_polygons(plane, *current, outside, behind, outside, behind);
+		std::swap(remaining, behind);
+		current = &remaining;
+		if (remaining.empty()) return;
+	}
+	if (inverted) out.append(*current);
+}
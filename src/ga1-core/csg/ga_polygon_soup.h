@@ -0,0 +1,206 @@
+#ifndef GA_POLYGON_SOUP_H
+#define GA_POLYGON_SOUP_H
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+** Evan Wallace - CSG.js - https://github.com/evanw/csg.js
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "math/ga_vec3f.h"
+#include "math/ga_mat4f.h"
+#include "ga_plane.h"
+#include "ga_csg_polygon.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/*
+** Structure-of-arrays storage for a list of convex polygons.
+**
+** Vertex positions and normals of every polygon live in two flat arrays.
+** Each polygon is a range [offset, offset + count) into them, plus an index
+** into the soup's plane table. Adding, copying and splitting polygons only
+** appends to these arrays, so the CSG pipeline never allocates per polygon.
+**
+** The plane table is shared, copy on write, with every soup the polygons are
+** copied or split into, so polygons keep their plane indices as they move
+** through an operation. A soup only copies the table when it adds a plane
+** the table does not have while another soup still shares it.
+*/
+class ga_polygon_soup
+{
+public:
+	ga_polygon_soup() {}
+	ga_polygon_soup(const std::vector<ga_polygon>& polys);
+
+	int size() const { return (int)_offsets.size(); }
+	bool empty() const { return _offsets.empty(); }
+	int get_vertex_count() const { return (int)_positions.size(); }
+
+	int get_count(int poly) const { return (int)_counts[poly]; }
+	const ga_vec3f* get_positions(int poly) const { return &_positions[_offsets[poly]]; }
+	const ga_vec3f* get_normals(int poly) const { return &_normals[_offsets[poly]]; }
+	const ga_csg_plane& get_plane(int poly) const { return _planes->get(_plane_indices[poly]); }
+	uint32_t get_plane_index(int poly) const { return _plane_indices[poly]; }
+	const ga_csg_plane_table* get_plane_table() const { return _planes.get(); }
+
+	void clear();
+	void reserve(int poly_count, int vertex_count);
+
+	/*
+	** Add a plane to the plane table, unless it is already there, and
+	** return its index.
+	*/
+	uint32_t add_plane(const ga_csg_plane& plane);
+
+	/*
+	** Return the index in this soup's plane table of the plane of another
+	** soup's polygon. When the soups share a table, or this soup has no
+	** polygons yet and can take on the other's, the index is unchanged.
+	*/
+	uint32_t import_plane(const ga_polygon_soup& other, int poly);
+
+	/*
+	** Incrementally add a polygon: begin, push its vertices, then end.
+	** end_polygon discards the polygon if it has fewer than three vertices
+	** and returns whether it was kept.
+	*/
+	void begin_polygon();
+	void push_vertex(const ga_vec3f& pos, const ga_vec3f& normal);
+	bool end_polygon(uint32_t plane_index);
+
+	/*
+	** Copy a single polygon, or every polygon, from another soup.
+	*/
+	void append(const ga_polygon_soup& other, int poly);
+	void append(const ga_polygon_soup& other);
+
+	/*
+	** Add a polygon from the vertex list representation.
+	*/
+	void append(const ga_polygon& poly);
+
+	/*
+	** Reverse the winding and normals of every polygon.
+	*/
+	void flip();
+
+	/*
+	** Transform every position by the given matrix.
+	*/
+	void transform(const ga_mat4f& mat);
+
+	/*
+	** Compute the axis-aligned bounds of the whole soup or of one polygon.
+	** The soup version returns false when the soup is empty.
+	*/
+	bool get_bounds(ga_vec3f& min, ga_vec3f& max) const;
+	void get_bounds(int poly, ga_vec3f& min, ga_vec3f& max) const;
+
+	/*
+	** Hash the soup's vertices and polygon layout.
+	** Equal soups hash equally; used to tell whether geometry has changed.
+	*/
+	uint64_t get_hash() const;
+
+	/*
+	** Convert back to the vertex list representation.
+	*/
+	ga_polygon get_polygon(int poly) const;
+	void get_polygons(std::vector<ga_polygon>& polys) const;
+
+	std::vector<ga_vec3f> _positions;
+	std::vector<ga_vec3f> _normals;
+	std::vector<uint32_t> _offsets;
+	std::vector<uint32_t> _counts;
+	std::vector<uint32_t> _plane_indices;
+	std::shared_ptr<ga_csg_plane_table> _planes;
+
+private:
+	// The plane table, copied first if another soup shares it.
+	ga_csg_plane_table& get_unique_planes();
+};
+
+/*
+** FNV-1a hash of a block of memory, continuing from a previous hash.
+*/
+uint64_t ga_csg_hash(const void* data, size_t size, uint64_t hash = 14695981039346656037ull);
+
+/*
+** Classify a polygon of the source soup against a plane and append it, or
+** the pieces of it on either side, to the matching output lists.
+** The output soups may alias each other but not the source.
+*/
+void split_polygon(const ga_csg_plane& plane,
+					const ga_polygon_soup& src,
+					int poly,
+					ga_polygon_soup& coplanar_front,
+					ga_polygon_soup& coplanar_back,
+					ga_polygon_soup& front,
+					ga_polygon_soup& back);
+
+/*
+** Same as split_polygon, for every polygon of the source soup.
+** Vertices are classified against the plane in large batches.
+*/
+void split_polygons(const ga_csg_plane& plane,
+					const ga_polygon_soup& src,
+					ga_polygon_soup& coplanar_front,
+					ga_polygon_soup& coplanar_back,
+					ga_polygon_soup& front,
+					ga_polygon_soup& back);
+
+/*
+** Same as split_polygons, for the polygons of the source soup from first
+** up to, but not including, end.
+*/
+void split_polygons(const ga_csg_plane& plane,
+					const ga_polygon_soup& src,
+					int first,
+					int end,
+					ga_polygon_soup& coplanar_front,
+					ga_polygon_soup& coplanar_back,
+					ga_polygon_soup& front,
+					ga_polygon_soup& back);
+
+/*
+** Same as above, splitting along plane plane_index of the source soup's
+** plane table. Polygons on that plane or its flip are sorted by comparing
+** indices, without classifying their vertices.
+*/
+void split_polygons(uint32_t plane_index,
+					const ga_polygon_soup& src,
+					int first,
+					int end,
+					ga_polygon_soup& coplanar_front,
+					ga_polygon_soup& coplanar_back,
+					ga_polygon_soup& front,
+					ga_polygon_soup& back);
+
+/*
+** Gather the distinct planes of the source soup's polygons, such as the face
+** planes of a convex solid. Returns false, with planes only partly filled,
+** as soon as there are more than max_planes of them.
+*/
+bool gather_planes(const ga_polygon_soup& src, int max_planes, std::vector<ga_csg_plane>& planes);
+
+/*
+** Clip the source polygons against the convex solid bounded by the given
+** face planes, one half-space at a time, appending the pieces outside the
+** solid to out, or with inverted, the pieces inside it. Coplanar polygons go
+** the same way as in ga_node::clip_polygons, which this matches for a tree
+** of the solid, at a cost of O(polygons * planes) and with no tree to build.
+*/
+void clip_polygons_to_convex(const std::vector<ga_csg_plane>& planes,
+							 const ga_polygon_soup& src,
+							 bool inverted,
+							 ga_polygon_soup& out);
+
+#endif
@@ -40,6 +40,7 @@ struct ga_static_drawcall : ga_drawcall
 {
 	GLuint _vao;
 	GLsizei _index_count;
+	GLenum _index_type = GL_UNSIGNED_SHORT;
 };
 
 /*
@@ -71,7 +71,7 @@ void ga_output::update(ga_frame_params* params)
 	{
 		d._material->bind(view_perspective, d._transform);
 		glBindVertexArray(d._vao);
-		glDrawElements(d._draw_mode, d._index_count, GL_UNSIGNED_SHORT, 0);
+		glDrawElements(d._draw_mode, d._index_count, d._index_type, 0);
 	}
 
 	// Draw all dynamic geometry:
@@ -215,6 +215,9 @@ ga_csg_material::ga_csg_material()
 
 ga_csg_material::~ga_csg_material()
 {
+	delete _program;
+	delete _fs;
+	delete _vs;
 }
 
 bool ga_csg_material::init()
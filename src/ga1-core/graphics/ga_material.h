@@ -24,6 +24,8 @@
 class ga_material
 {
 public:
+	virtual ~ga_material() {}
+
 	virtual bool init() = 0;
 
 	virtual void bind(const ga_mat4f& view_proj, const ga_mat4f& transform) = 0;
@@ -117,12 +119,12 @@ public:
 	virtual void set_secondary(bool toggle) { _secondary = toggle; };
 
 private:
-	ga_shader* _vs;
-	ga_shader* _fs;
+	ga_shader* _vs = nullptr;
+	ga_shader* _fs = nullptr;
 	ga_mat4f _csg_transform;
 	bool _highlighted = false;
 	bool _selected = false;
 	bool _secondary = false;
-	ga_program* _program;
+	ga_program* _program = nullptr;
 	ga_vec3f _color;
 };
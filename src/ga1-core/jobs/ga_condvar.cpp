@@ -9,7 +9,7 @@
 
 #include "ga_condvar.h"
 
-ga_condvar::ga_condvar()
+ga_condvar::ga_condvar() : _generation(0)
 {
 }
 
@@ -31,5 +31,27 @@ void ga_condvar::wait_for(int ms)
 
 void ga_condvar::wake_all()
 {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		++_generation;
+	}
 	_condvar.notify_all();
 }
+
+uint32_t ga_condvar::get_generation()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _generation;
+}
+
+void ga_condvar::wait(uint32_t generation)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_condvar.wait(lock, [&]() { return _generation != generation; });
+}
+
+void ga_condvar::wait_for(int ms, uint32_t generation)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_condvar.wait_for(lock, std::chrono::milliseconds(ms), [&]() { return _generation != generation; });
+}
@@ -10,6 +10,7 @@
 */
 
 #include <condition_variable>
+#include <cstdint>
 #include <mutex>
 
 /*
@@ -25,7 +26,17 @@ public:
 	void wait_for(int ms);
 	void wake_all();
 
+	/*
+	** Wakes that happen between get_generation() and a wait on that
+	** generation are not lost: the wait returns immediately. Read the
+	** generation before checking whatever condition is being waited on.
+	*/
+	uint32_t get_generation();
+	void wait(uint32_t generation);
+	void wait_for(int ms, uint32_t generation);
+
 private:
 	std::condition_variable _condvar;
 	std::mutex _mutex;
+	uint32_t _generation;
 };
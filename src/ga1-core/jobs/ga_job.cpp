@@ -27,6 +27,7 @@ struct ga_job_instance_t
 	ga_job_decl_t* _decl;
 
 	int32_t* _waiting_count;
+	bool _waiting;
 
 	int _pool_index;
 
@@ -107,6 +108,8 @@ void ga_job::shutdown()
 	}
 
 	delete[] impl->_job_instance_data;
+	delete impl;
+	_impl = 0;
 }
 
 void ga_job::run(ga_job_decl_t* decls, int decl_count, int32_t* counter)
@@ -129,14 +132,17 @@ void ga_job::wait(int32_t* counter)
 	{
 		/*
 		** If we're not the main thread, assume we're waiting from within a job.
-		** In this case, push the current job onto the wait list, and reschedule.
+		** In this case, mark the current job as waiting and switch back to the
+		** worker, which puts it on the wait list once this fiber is switched
+		** out. Pushing it here would let another worker resume the fiber
+		** before this thread has left it.
 		*/
 		ga_job_system_impl_t* impl = static_cast<ga_job_system_impl_t*>(_impl);
 		if (std::this_thread::get_id() != impl->_main_thread)
 		{
 			ga_job_instance_t* job = static_cast<ga_job_instance_t*>(ga_fiber::get_data());
 			job->_waiting_count = counter;
-			impl->_wait_queue.push(job);
+			job->_waiting = true;
 
 			ga_fiber::switch_to(*job->_parent_fiber);
 		}
@@ -145,14 +151,21 @@ void ga_job::wait(int32_t* counter)
 		*/
 		else
 		{
-			while (*counter > 0)
+			for (;;)
 			{
-				impl->_work_exhausted.wait();
+				uint32_t generation = impl->_work_exhausted.get_generation();
+				if (*counter <= 0) break;
+				impl->_work_exhausted.wait(generation);
 			}
 		}
 	}
 }
 
+bool ga_job::is_done(const int32_t* counter)
+{
+	return reinterpret_cast<const std::atomic_int*>(counter)->load() <= 0;
+}
+
 static int _ga_job_instance_thread_worker(void* data)
 {
 	ga_job_system_impl_t* impl = static_cast<ga_job_system_impl_t*>(data);
@@ -161,10 +174,11 @@ static int _ga_job_instance_thread_worker(void* data)
 
 	while (!impl->_terminate)
 	{
+		uint32_t generation = impl->_work_added.get_generation();
 		if (!_ga_job_schedule(impl, &parent_fiber))
 		{
 			impl->_work_exhausted.wake_all();
-			impl->_work_added.wait_for(1000);
+			impl->_work_added.wait_for(1000, generation);
 		}
 	}
 
@@ -178,7 +192,7 @@ static bool _ga_job_schedule(ga_job_system_impl_t* impl, ga_fiber* parent_fiber)
 	int retry_wait_count = impl->_wait_queue.get_count();
 	while (retry_wait_count-- > 0 && impl->_wait_queue.pop((void**)&job))
 	{
-		if (job->_waiting_count == 0 || job->_waiting_count[0] == 0)
+		if (job->_waiting_count == 0 || ga_job::is_done(job->_waiting_count))
 		{
 			_ga_job_run(impl, parent_fiber, job);
 			return true;
@@ -211,10 +225,19 @@ static void _ga_job_run(ga_job_system_impl_t* impl, ga_fiber* parent_fiber, ga_j
 {
 	job->_parent_fiber = parent_fiber;
 	job->_waiting_count = 0;
+	job->_waiting = false;
 
 	ga_fiber::switch_to(job->_fiber);
 
-	if (job->_waiting_count == 0 || job->_waiting_count[0] == 0)
+	/*
+	** A job that yielded from ga_job::wait is off its fiber only now, so it
+	** is safe to queue for another worker. Otherwise the entry returned.
+	*/
+	if (job->_waiting)
+	{
+		impl->_wait_queue.push(job);
+	}
+	else
 	{
 		impl->_job_instance_pool.free(job->_pool_index);
 
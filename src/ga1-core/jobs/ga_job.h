@@ -46,6 +46,18 @@ public:
 
 	static void wait(int32_t* counter);
 
+	/*
+	** Returns true once every job counted by the counter has finished.
+	** Unlike wait, never blocks, so the main thread can poll long jobs once a frame.
+	*/
+	static bool is_done(const int32_t* counter);
+
+	/*
+	** Returns true between startup and shutdown.
+	** Systems that can fall back to serial work check this before using jobs.
+	*/
+	static bool is_running() { return _impl != 0; }
+
 private:
 	static void* _impl;
 };
@@ -135,6 +135,9 @@ int main(int argc, const char** argv)
 		// Perform the late update.
 		sim->late_update(&params);
 
+		// Add the results of CSG operations that finished in the background.
+		my_csg.finish_operations();
+
 		// Run gui test.
 		gui_test(&params, my_csg);
 
@@ -409,27 +412,18 @@ static void gui_test(ga_frame_params* params, ga_csg_component& comp)
 	ga_button sub_button = ga_button("Subtract", 75.0f, 610.0f, params);
 	ga_button intersect_button = ga_button("Intersect", 155.0f, 610.0f, params);
 	if (union_button.get_clicked(params)) {
-		ga_csg* temp = new ga_csg(selected->add(*selected2));
 		std::string name1 = (selected->name[0] == '(') ? "(" + selected->name : "(" + selected->name + std::to_string(selected->id);
 		std::string name2 = (selected2->name[0] == '(') ? selected2->name + ")" : selected2->name + std::to_string(selected2->id) + ")";
-		temp->name = name1 + "+" + name2;
-		temp->id = comp.get_id();
-		comp.add(temp);
+		comp.submit(*selected, *selected2, ga_csg::OP::ADD)->set_name(name1 + "+" + name2);
 	}
 	if (sub_button.get_clicked(params)) {
-		ga_csg* temp = new ga_csg(selected->subtract(*selected2));
 		std::string name1 = (selected->name[0] == '(') ? "(" + selected->name : "(" + selected->name + std::to_string(selected->id);
 		std::string name2 = (selected2->name[0] == '(') ? selected2->name + ")" : selected2->name + std::to_string(selected2->id) + ")";
-		temp->name = name1 + "-" + name2;
-		temp->id = comp.get_id();
-		comp.add(temp);
+		comp.submit(*selected, *selected2, ga_csg::OP::SUB)->set_name(name1 + "-" + name2);
 	}
 	if (intersect_button.get_clicked(params)) {
-		ga_csg* temp = new ga_csg(selected->subtract(*selected2));
 		std::string name1 = (selected->name[0] == '(') ? "(" + selected->name : "(" + selected->name + std::to_string(selected->id);
 		std::string name2 = (selected2->name[0] == '(') ? selected2->name + ")" : selected2->name + std::to_string(selected2->id) + ")"; 
-		temp->name = name1 + "x" + name2;
-		temp->id = comp.get_id();
-		comp.add(temp);
+		comp.submit(*selected, *selected2, ga_csg::OP::INTERSECT)->set_name(name1 + "x" + name2);
 	}
 }
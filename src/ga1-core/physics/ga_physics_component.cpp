@@ -20,6 +20,13 @@ ga_physics_component::ga_physics_component(ga_entity* ent, ga_shape* shape, floa
 	_body->_transform = ent->get_transform();
 }
 
+ga_physics_component::ga_physics_component(ga_entity* ent, ga_shape* shape, float mass, const ga_mat4f& inertia_tensor)
+	: ga_component(ent)
+{
+	_body = new ga_rigid_body(shape, mass, inertia_tensor);
+	_body->_transform = ent->get_transform();
+}
+
 ga_physics_component::~ga_physics_component()
 {
 	delete _body;
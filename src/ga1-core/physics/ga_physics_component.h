@@ -19,6 +19,7 @@ class ga_physics_component : public ga_component
 {
 public:
 	ga_physics_component(class ga_entity* ent, struct ga_shape* shape, float mass);
+	ga_physics_component(class ga_entity* ent, struct ga_shape* shape, float mass, const struct ga_mat4f& inertia_tensor);
 	virtual ~ga_physics_component();
 
 	virtual void update(struct ga_frame_params* params) override;
@@ -18,6 +18,13 @@ ga_rigid_body::ga_rigid_body(ga_shape* shape, float mass) : _mass(mass), _shape(
 	_shape->get_inertia_tensor(_inertia_tensor, _mass);
 }
 
+ga_rigid_body::ga_rigid_body(ga_shape* shape, float mass, const ga_mat4f& inertia_tensor)
+	: _inertia_tensor(inertia_tensor), _mass(mass), _shape(shape), _flags(0)
+{
+	_transform.make_identity();
+	_orientation.make_axis_angle(ga_vec3f::y_vector(), 0);
+}
+
 ga_rigid_body::~ga_rigid_body()
 {
 }
@@ -29,6 +29,12 @@ class ga_rigid_body final
 {
 public:
 	ga_rigid_body(struct ga_shape* shape, float mass);
+
+	/*
+	** Creates a body whose inertia tensor is given rather than taken from
+	** its shape, such as one computed from the mesh of a CSG solid.
+	*/
+	ga_rigid_body(struct ga_shape* shape, float mass, const ga_mat4f& inertia_tensor);
 	~ga_rigid_body();
 
 	void get_debug_draw(struct ga_dynamic_drawcall* drawcall);